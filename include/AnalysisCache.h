@@ -0,0 +1,73 @@
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+#include "header.h"
+#include "BallFrameState.h"
+#include <cstdint>
+#include <cstdio>
+
+// Header of an analysis cache, followed by one raw BallFrameState per analysed frame
+struct AnalysisCacheHeader {
+    char magic[4];                  // "SVAC"
+    uint32_t version;
+    uint32_t record_size;           // sizeof(BallFrameState) of the writer
+    int32_t frame_width;
+    int32_t frame_height;
+    int32_t start;                  // first frame of the range, used to detect the table
+    int32_t stride;
+    int32_t map_width;              // minimap of the homography
+    int32_t map_height;
+    double fps;
+    float corners[8];               // table corners in the order of TableDetection::tableCorners_
+    float sorted_corners[8];        // table polygon: top-left, top-right, bottom-right, bottom-left
+    double homography[9];           // perspective transformation from the frame to the minimap
+};
+
+// Content of the header with OpenCV types
+struct AnalysisInfo {
+    cv::Size frame_size;
+    int start = 0;
+    int stride = 1;
+    cv::Size map_size;
+    double fps = 0;
+    std::vector<cv::Point2f> corners;
+    std::vector<cv::Point2f> sorted_corners;
+    cv::Mat homography;
+};
+
+// Save the balls of every analysed frame, to render the output again without the detection
+class AnalysisCacheWriter {
+
+public:
+    ~AnalysisCacheWriter();
+    // Function to create the cache, or to append to it when a run is resumed
+    bool open(const std::string& path, const AnalysisInfo& info, bool append);
+    bool write(const BallFrameState& balls);
+    bool flush();
+    void close();
+
+private:
+    FILE* file_ = nullptr;
+};
+
+// Read the balls saved by AnalysisCacheWriter, in the order of the frames
+class AnalysisCacheReader {
+
+public:
+    ~AnalysisCacheReader();
+    bool open(const std::string& path);
+    const AnalysisInfo& info() const { return info_; }
+    // Function to read the balls of a frame, returns false when the frame was not analysed
+    bool read(int frame, BallFrameState& balls);
+    void close();
+
+private:
+    bool readNext();
+
+    FILE* file_ = nullptr;
+    AnalysisInfo info_;
+    BallFrameState next_;
+    bool has_next_ = false;
+};
+
+
+#endif //ANALYSISCACHE_H
@@ -0,0 +1,11 @@
+#ifndef ARGPARSE_H
+#define ARGPARSE_H
+#include "header.h"
+
+// Function to parse an integer argument, the whole text must be a number not below min_value
+bool parseInt(const char* text, int min_value, int& value);
+// Function to parse a real argument, the whole text must be a finite number not below min_value
+bool parseDouble(const char* text, double min_value, double& value);
+
+
+#endif //ARGPARSE_H
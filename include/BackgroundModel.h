@@ -0,0 +1,32 @@
+#ifndef BACKGROUNDMODEL_H
+#define BACKGROUNDMODEL_H
+#include "header.h"
+#include "FrameContext.h"
+
+// Colors of the empty table of a fixed camera, to segment the balls as the pixels that differ from it
+class BackgroundModel {
+
+public:
+    // Function to build the model as the per-pixel median of frames sampled over the video. The
+    // pixels set in the mask of a frame (its balls, of the frame size) are left out of the median,
+    // so that a ball at rest in every frame does not become part of the model
+    bool build(const std::vector<cv::Mat>& frames, const std::vector<cv::Mat>& masks, const TableSpans& spans);
+    bool ready() const { return !model_.empty(); }
+    void clear() { model_.release(); }
+
+    // Function to compute the mask of the table pixels that differ from the model, of the size of the
+    // roi, and to move the model slowly towards the other pixels. A foreground pixel that has not
+    // changed for background_absorb frames is copied into the model
+    cv::Mat foreground(FrameContext& context);
+
+private:
+    cv::Mat model_;                 // median color of each table pixel, one row per pixel in the order of the spans
+    int update_interval_ = 8;       // frames between two updates of one level
+    int frames_ = 0;
+    cv::Mat age_;                   // frames for which each table pixel has been foreground without changing
+    cv::Mat previous_;              // table pixels of the previous frame
+    cv::Mat diff_, max_diff_, packed_fg_, fg3_, up_, down_, still_, absorb_;
+};
+
+
+#endif //BACKGROUNDMODEL_H
@@ -0,0 +1,52 @@
+#ifndef BALLCACHE_H
+#define BALLCACHE_H
+#include "header.h"
+#include "BallFrameState.h"
+
+// Ball refined from a candidate, with the norm of its mean color used by the classification
+struct CachedBall {
+    float x, y, radius, confidence, norm;
+};
+
+// Balls refined around one candidate center and the grayscale patch they were refined on
+struct BallCacheEntry {
+    cv::Point2f candidate;
+    cv::Rect box;                   // bounding box of the refined balls in the frame
+    cv::Mat patch;                  // grayscale of the box when the balls were refined
+    std::vector<CachedBall> balls;
+    std::vector<int> indices;       // index of each ball in the state of the current frame, empty when not used
+    int last_seen = 0;              // last frame in which the entry was used
+};
+
+// Results of the refinement of the balls at rest, reused while their patch does not change,
+// so that only the balls that moved are refined and classified again
+class BallCache {
+
+public:
+    void clear();
+    void beginFrame();
+    // Function to push the cached balls of a candidate into the state when the candidate and the
+    // patch around its balls did not change, returns false when the candidate must be refined
+    bool reuse(const cv::Point2f& candidate, const cv::Mat& gray, BallFrameState& balls);
+    // Function to save the balls refined from a candidate, pushed in the state from the index first
+    void store(const cv::Point2f& candidate, const cv::Mat& gray, const BallFrameState& balls, int first);
+    // Function to save the norms computed by the classification for the balls of the current frame
+    void commit(const BallFrameState& balls);
+
+    int reused() const { return reused_; }
+    int refined() const { return refined_; }
+
+private:
+    BallCacheEntry* find(const cv::Point2f& candidate);
+
+    std::vector<BallCacheEntry> entries_;
+    int frame_ = 0;
+    int reused_ = 0;
+    int refined_ = 0;
+    float max_distance_ = 3.0f;     // candidate of the same ball, in pixels
+    double max_difference_ = 6.0;   // mean absolute difference of the patch of a ball at rest
+    int max_age_ = 25;              // frames after which an unused entry is dropped
+};
+
+
+#endif //BALLCACHE_H
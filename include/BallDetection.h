@@ -1,21 +1,82 @@
 #ifndef BALLDETECTION_H
 #define BALLDETECTION_H
 #include "header.h"
+#include "EventDetection.h"
+#include "OutputSink.h"
+#include "TableCalibration.h"
+#include "BallFrameState.h"
+#include "BallStateRing.h"
+#include "AnalysisCache.h"
+#include "FrameContext.h"
+#include "BackgroundModel.h"
+#include "BallCache.h"
+#include "DetectorConfig.h"
+
+// Options selecting which frames of the video are analysed
+struct ProcessOptions {
+    int start = 0;   // index of the first frame to process
+    int end = -1;    // index of the last frame to process (-1 until the end of the video)
+    int stride = 1;  // analyse one frame every stride frames, the others are only grabbed
+    bool analysis_only = false;  // only save the detections and the final minimap, no output video
+    std::string sink = "video";  // output sink: video, images, raw, y4m or null
+    std::string codec;           // fourcc of the video sink or image format of the images sink
+    int compression = -1;        // png compression level or jpg quality of the images sink
+    bool preview = true;         // show the output frames in a window
+    std::string calibration;     // calibration file of the camera, created when missing or not matching
+    int checkpoint = 0;          // analysed frames between two checkpoints (0 without checkpoints)
+    bool resume = false;         // continue from the last checkpoint of the output
+    std::string shm;             // shared memory where the balls of every frame are published (empty to disable)
+    std::string save_analysis;   // cache file where the balls of every analysed frame are saved
+    std::string render_from;     // render the output from a cache file, without the detection
+    cv::Size map_size;           // size of the minimap (empty for 400x800)
+    int ball_radius = 12;        // radius of the balls on the minimap
+    bool trail = true;           // draw the trajectories of the balls on the minimap
+    std::string overlay = "bottom-left"; // corner of the minimap in the output: top-left, top-right, bottom-left or bottom-right
+    bool verify_mask = false;    // compare the contour mask with the untiled chain and report the differences
+    bool background = false;     // segment the balls against a model of the empty table instead of KMeans
+    bool verify_background = false; // also compute the KMeans mask and report the accuracy of the background mask
+    bool ball_cache = false;     // reuse the refinement and the color norm of the balls at rest
+};
+
+// Progress of process_video saved in the checkpoints
+struct Checkpoint {
+    int next_frame = 0;          // index of the next frame to process
+    int frame_num = 0;           // number of analysed frames
+    int segment = 0;             // index of the output segment being written
+    int failed = 0;              // number of frames that could not be analysed
+    bool first_saved = false;    // outputs of the first frame already saved
+};
 
 class BallDetection {
 
 public:
     BallDetection();
-    cv::Mat removePixel(cv::Mat img, int rmp);
-    bool processTableObjects(const cv::Mat& frame, const cv::Rect& roiRect);
+    cv::Mat removePixel(cv::Mat img, int rmp, const TableSpans* spans = nullptr);
+    bool processTableObjects(FrameContext& context);
     cv::Mat create_table(int width, int height);
-    cv::Mat draw_balls( const std::vector<cv::Point2f>& minimapBallPositions, const cv::Mat& background, int radius, int size, const cv::Mat& img);
+    cv::Mat draw_balls(const cv::Mat& background, int radius, int size);
     cv::Mat draw_holes(const cv::Mat& input_img);
-    bool createTopViewMinimap(const std::vector<cv::Point2f>& ballPositions, const cv::Mat& img, const std::vector<cv::Point2f>& tableCorners);
-    bool outputGenerator(const std::vector<cv::Point2f>& ballPositions, const cv::Mat& img, int radius, const cv::Mat& mask_table, const cv::Mat& bb_table, const std::string& filename);
+    bool createTopViewMinimap(const std::vector<cv::Point2f>& tableCorners);
+    void classifyBalls(const cv::Mat& img);
+    bool outputGenerator(const cv::Mat& img, int radius, const cv::Mat& mask_table, const cv::Mat& bb_table, const std::string& filename);
     static void saveDetections(const std::string& filename, const std::vector<cv::Point2f>& centers, const std::vector<int>& labels, const std::vector<cv::Rect>& boundingBoxes);
-    bool centerRefinement(cv::Mat img);
-    bool process_video(const std::string& input_path,const std::string& output_path);
+    bool centerRefinement(FrameContext& context);
+    cv::Mat composeOutput(const cv::Mat& frame, const cv::Size& final_size);
+    bool detectBalls(const cv::Mat& frame, const TableSpans& table);
+    bool analyzeFrame(const cv::Mat& frame, const TableSpans& table, const std::vector<cv::Point2f>& tableCorners);
+    const BallFrameState& balls() const { return balls_; }
+    bool saveCheckpoint(const std::string& filename, const Checkpoint& state, const ProcessOptions& options,
+                        const TableCalibration& calibration, const EventDetection& events) const;
+    bool loadCheckpoint(const std::string& filename, Checkpoint& state, const ProcessOptions& options,
+                        TableCalibration& calibration, EventDetection& events);
+    bool process_video(const std::string& input_path,const std::string& output_path, const ProcessOptions& options = ProcessOptions());
+    bool render_video(const std::string& input_path,const std::string& output_path, const ProcessOptions& options);
+    void setConfig(const DetectorConfig& config) { config_ = config; }
+    const DetectorConfig& config() const { return config_; }
+    // Function to create the mask of the contours of the table objects, tiled, and the same mask
+    // with one full pass per filter, which the tiled one must reproduce exactly
+    cv::Mat contourMask(FrameContext& context);
+    cv::Mat referenceContourMask(const cv::Mat& gray);
 
 
 
@@ -28,15 +89,46 @@ private:
     cv::VideoCapture capture_;
     cv::Mat top_view_;
     std::vector<cv::Point2f> centers_;
-    std::vector<cv::Point2f> centers_ref_;
-    std::vector<float> radius_;
+    BallFrameState balls_;
+    FrameContext context_;
     std::vector<cv::Point2f> points_;
+    std::vector<cv::Point2f> prev_minimap_;
+    int stride_ = 1;
+    cv::Mat homography_;
+    cv::Mat cloth_centers_;
+    bool warm_start_ = false;       // KMeans starts from cloth_centers_ instead of k-means++
     cv::Point2f transformPoint(const cv::Point2f& point, const cv::Mat& transformMatrix);
+    void interpolateTrajectory(const cv::Point2f& position);
+    cv::Mat computeHomography(const std::vector<cv::Point2f>& tableCorners) const;
+    void setRenderOptions(const ProcessOptions& options);
+    cv::Mat tableObjectMask(FrameContext& context);
+    std::vector<cv::Point2f> maskCenters(FrameContext& context, const cv::Mat& mask);
+    void compareBackground(FrameContext& context, const cv::Mat& foreground, const cv::Mat& reference);
+    bool buildBackground(const TableSpans& spans, int first, int last);
 
 
 
     int width_ = 400;
     int height_ = 800;
+    int ball_radius_ = 12;
+    bool draw_trail_ = true;
+    std::string overlay_ = "bottom-left";
+    bool verify_mask_ = false;
+    double contour_ticks_ = 0;
+    double reference_ticks_ = 0;
+    int mask_mismatches_ = 0;
+    BackgroundModel background_;
+    bool use_background_ = false;
+    bool verify_background_ = false;
+    double background_ticks_ = 0;
+    double mask_ticks_ = 0;
+    double iou_sum_ = 0;
+    int verified_frames_ = 0;
+    int centers_matched_ = 0;
+    int centers_expected_ = 0;
+    BallCache ball_cache_;
+    bool ball_cache_enabled_ = false;
+    DetectorConfig config_;
 
 
 
@@ -46,13 +138,16 @@ private:
 
 };
 
+// Function to sort the table corners: top-left, top-right, bottom-right, bottom-left
+std::vector<cv::Point2f> sortCorners(const std::vector<cv::Point2f>& corners);
+
 class TableDetection {
 public:
 
     explicit TableDetection(BallDetection *ballDetection);
     bool detectTableCorners(const cv::Mat &firstFrame);
     cv::Point2f computeIntersection(cv::Vec2f line1, cv::Vec2f line2);
-    cv::Mat KMeans(cv::Mat src);
+    cv::Mat KMeans(FrameContext& context);
     std::vector<cv::Point2f> tableCorners_;
 
 
@@ -0,0 +1,60 @@
+#ifndef BALLFRAMESTATE_H
+#define BALLFRAMESTATE_H
+#include "header.h"
+#include <type_traits>
+
+// Labels of the balls, as saved in the detection files
+enum BallLabel {
+    LABEL_UNKNOWN = 0,
+    LABEL_WHITE = 1,
+    LABEL_BLACK = 2,
+    LABEL_SOLID = 3,
+    LABEL_STRIPED = 4
+};
+
+// Balls of one frame stored as a structure of arrays with a fixed capacity. The same index
+// refers to the same ball in every stage, and the state can be copied with a plain memcpy.
+struct BallFrameState {
+    static constexpr int kCapacity = 32; // a full rack plus room for duplicated detections
+
+    int frame = -1;                     // index of the frame in the video
+    int count = 0;                      // number of balls
+
+    float x[kCapacity];                 // center in the frame
+    float y[kCapacity];
+    float radius[kCapacity];
+    float map_x[kCapacity];             // center on the minimap
+    float map_y[kCapacity];
+    int label[kCapacity];               // BallLabel
+    float confidence[kCapacity];        // 1 when refined on the grayscale image, lower on the red channel
+    float norm[kCapacity];              // L2 norm of the mean color used by the classification, -1 until computed
+    int track_id[kCapacity];            // id assigned by EventDetection, -1 when not tracked
+
+    void clear() { count = 0; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == kCapacity; }
+    cv::Point2f center(int i) const { return cv::Point2f(x[i], y[i]); }
+    cv::Point2f mapCenter(int i) const { return cv::Point2f(map_x[i], map_y[i]); }
+
+    // Function to add a ball, returns its index or -1 when the state is full
+    int push(float cx, float cy, float r, float conf) {
+        if (full()) return -1;
+        int i = count++;
+        x[i] = cx;
+        y[i] = cy;
+        radius[i] = r;
+        map_x[i] = 0;
+        map_y[i] = 0;
+        label[i] = LABEL_UNKNOWN;
+        confidence[i] = conf;
+        norm[i] = -1;
+        track_id[i] = -1;
+        return i;
+    }
+};
+
+static_assert(std::is_trivially_copyable<BallFrameState>::value, "BallFrameState must be copyable with memcpy");
+
+
+#endif //BALLFRAMESTATE_H
@@ -0,0 +1,84 @@
+#ifndef BALLSTATERING_H
+#define BALLSTATERING_H
+#include "header.h"
+#include "BallFrameState.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sys/types.h>
+
+// Layout of the shared memory: a header followed by slot_count slots. The slot of the state n is
+// n % slot_count, and its sequence number is 2n + 1 while it is written and 2n + 2 once complete,
+// so a reader detects a state that was overwritten while it was copied. A ring is retired when its
+// producer closes it or when a new producer replaces it, and the readers then attach to the new ring.
+struct BallStateRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    int32_t map_width;                  // size of the minimap of the map coordinates
+    int32_t map_height;
+    std::atomic<uint32_t> retired;      // no state will be published in this ring anymore
+    alignas(64) std::atomic<uint64_t> write_seq;    // number of published states
+};
+
+struct BallStateSlot {
+    alignas(64) std::atomic<uint64_t> seq;
+    BallFrameState state;
+};
+
+static constexpr uint32_t kBallStateRingMagic = 0x53564142; // "SVAB"
+static constexpr uint32_t kBallStateRingVersion = 3;
+
+// Single producer of the ring, never waits for the readers
+class BallStatePublisher {
+
+public:
+    ~BallStatePublisher();
+    bool open(const std::string& name, int map_width, int map_height, uint32_t slot_count = 64);
+    void publish(const BallFrameState& balls);
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+private:
+    std::string name_;
+    BallStateRingHeader* header_ = nullptr;
+    BallStateSlot* slots_ = nullptr;
+    size_t bytes_ = 0;
+    ino_t inode_ = 0;                   // object created by this publisher, the only one it unlinks
+};
+
+// Reader of the ring, any number of readers can be attached to the same ring
+class BallStateReader {
+
+public:
+    ~BallStateReader();
+    bool open(const std::string& name);
+    // Function to read the next state, returns false when no new state was published.
+    // A reader slower than the producer skips the overwritten states, counted by lost().
+    // When the ring is retired, the reader attaches to the ring of the next producer.
+    bool next(BallFrameState& balls);
+    // Function to read the most recent state, skipping the older ones
+    bool latest(BallFrameState& balls);
+    void close();
+    uint64_t lost() const { return lost_; }
+    int mapWidth() const { return header_ ? header_->map_width : 0; }
+    int mapHeight() const { return header_ ? header_->map_height : 0; }
+
+private:
+    bool map(int fd);
+    bool reattach();
+    bool readSlot(uint64_t seq, BallFrameState& balls) const;
+
+    std::string name_;
+    const BallStateRingHeader* header_ = nullptr;
+    const BallStateSlot* slots_ = nullptr;
+    size_t bytes_ = 0;
+    ino_t inode_ = 0;
+    uint64_t next_ = 0;
+    uint64_t lost_ = 0;
+    std::chrono::steady_clock::time_point last_attach_;
+};
+
+
+#endif //BALLSTATERING_H
@@ -0,0 +1,93 @@
+#ifndef DETECTORCONFIG_H
+#define DETECTORCONFIG_H
+#include "header.h"
+#include <type_traits>
+
+// Parameters of the ball detection, which can be loaded from a file and tuned with ParamSweep
+struct DetectorConfig {
+    // Candidate centers, Hough transform of findCenters
+    double candidate_canny = 107;       // upper threshold of the internal Canny
+    double candidate_votes = 10;        // accumulator threshold
+    int candidate_min_radius = 5;
+    int candidate_max_radius = 12;
+    int min_dist_divisor = 16;          // minimum distance between two centers: frame rows / divisor
+
+    // Refinement of each candidate, Hough transform of centerRefinement
+    int refine_window = 30;             // radius of the window around the candidate
+    double refine_canny = 107;
+    double refine_votes = 10;
+    int refine_min_radius = 5;
+    int refine_max_radius = 15;
+    double small_radius = 6.5;          // circles smaller than this get the radius min_radius
+    double min_radius = 7.1;
+    double radius_padding = 2;          // added to the refined radius
+
+    // Mask of the table objects
+    int median_size = 7;
+    double gaussian_sigma = 2;
+    double canny_low = 50;
+    double canny_high = 100;
+    int close_size = 5;                 // closing of the edges
+    int dilate_width = 3;               // dilation of the contours
+    int dilate_height = 5;
+    int dilate_iterations = 2;
+    int max_blob_area = 3000;           // removePixel limit
+    int background_threshold = 30;      // difference of a channel from the background model
+    int background_absorb = 1500;       // frames after which an unchanged foreground pixel joins the model
+
+    // Classification
+    double striped_norm = 200;          // L2 norm of the mean color between solid and striped balls
+
+    // Function to call f(name, value) for every parameter
+    template <typename F>
+    void visit(F f) { visitFields(*this, f); }
+    template <typename F>
+    void visit(F f) const { visitFields(*this, f); }
+
+    // Function to set a parameter by name, returns false for an unknown name or when an integer
+    // parameter is given a value that is not an integer
+    bool set(const std::string& name, double value);
+    std::string describe() const;
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+    bool read(const cv::FileNode& node);
+    void write(cv::FileStorage& fs) const;
+    // Function to check the values that OpenCV would reject, that would divide by zero or that are not a range
+    bool valid() const;
+
+    // Rows needed above and below a tile by the median and the gaussian blur
+    int blurHalo() const;
+
+private:
+    template <typename Config, typename F>
+    static void visitFields(Config& c, F& f) {
+        f("candidate_canny", c.candidate_canny);
+        f("candidate_votes", c.candidate_votes);
+        f("candidate_min_radius", c.candidate_min_radius);
+        f("candidate_max_radius", c.candidate_max_radius);
+        f("min_dist_divisor", c.min_dist_divisor);
+        f("refine_window", c.refine_window);
+        f("refine_canny", c.refine_canny);
+        f("refine_votes", c.refine_votes);
+        f("refine_min_radius", c.refine_min_radius);
+        f("refine_max_radius", c.refine_max_radius);
+        f("small_radius", c.small_radius);
+        f("min_radius", c.min_radius);
+        f("radius_padding", c.radius_padding);
+        f("median_size", c.median_size);
+        f("gaussian_sigma", c.gaussian_sigma);
+        f("canny_low", c.canny_low);
+        f("canny_high", c.canny_high);
+        f("close_size", c.close_size);
+        f("dilate_width", c.dilate_width);
+        f("dilate_height", c.dilate_height);
+        f("dilate_iterations", c.dilate_iterations);
+        f("max_blob_area", c.max_blob_area);
+        f("background_threshold", c.background_threshold);
+        f("background_absorb", c.background_absorb);
+        f("striped_norm", c.striped_norm);
+    }
+};
+
+
+#endif //DETECTORCONFIG_H
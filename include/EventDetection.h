@@ -0,0 +1,108 @@
+#ifndef EVENTDETECTION_H
+#define EVENTDETECTION_H
+#include "header.h"
+#include "BallFrameState.h"
+
+// Types of the events stored in the shot index
+enum EventType {
+    EVENT_MOTION_START = 0,
+    EVENT_MOTION_STOP = 1,
+    EVENT_COLLISION = 2,
+    EVENT_POCKETED = 3
+};
+
+struct BallEvent {
+    int frame;
+    EventType type;
+    int ball;       // id of the tracked ball
+    int other;      // id of the other ball of a collision, -1 otherwise
+    cv::Point2f position;   // position on the minimap
+};
+
+struct Shot {
+    int start;      // first frame with a moving ball
+    int end;        // last frame with a moving ball
+};
+
+class EventDetection {
+
+public:
+    EventDetection(int width, int height);
+    void update(int frame, BallFrameState& balls);
+    void finish();
+    bool saveIndex(const std::string& filename) const;
+    bool read(const cv::FileStorage& fs);
+    void write(cv::FileStorage& fs) const;
+    const std::vector<BallEvent>& events() const { return events_; }
+    const std::vector<Shot>& shots() const { return shots_; }
+
+
+private:
+    struct Track {
+        int id;
+        int label;
+        cv::Point2f position;
+        cv::Point2f velocity;   // minimap pixels per frame
+        bool moving;
+        int missing;            // frames since the ball was last seen
+    };
+
+    // Points of the minimap bucketed in square cells, so that the points closer than one cell to a
+    // position are found in the 3x3 cells around it instead of comparing it with all the points
+    class CellGrid {
+    public:
+        void build(const std::vector<cv::Point2f>& points, float cell, const cv::Size& area);
+        template <typename F>
+        void forNear(const cv::Point2f& position, F f) const {
+            int cx = cellX(position.x), cy = cellY(position.y);
+            for (int y = std::max(0, cy - 1); y <= std::min(rows_ - 1, cy + 1); y++) {
+                for (int x = std::max(0, cx - 1); x <= std::min(cols_ - 1, cx + 1); x++) {
+                    int c = y * cols_ + x;
+                    for (int i = start_[c]; i < start_[c + 1]; i++) f(items_[i]);
+                }
+            }
+        }
+
+    private:
+        // Points outside the minimap go to the border cells, which keeps close points in adjacent cells
+        int cellX(float x) const { return std::min(cols_ - 1, std::max(0, static_cast<int>(std::floor(x / cell_)))); }
+        int cellY(float y) const { return std::min(rows_ - 1, std::max(0, static_cast<int>(std::floor(y / cell_)))); }
+
+        float cell_ = 1;
+        int cols_ = 0;
+        int rows_ = 0;
+        std::vector<int> start_;    // first item of each cell, and the end of the last one
+        std::vector<int> items_;    // indices of the points, grouped by cell
+        std::vector<int> next_;
+    };
+
+    void addEvent(int frame, EventType type, const Track& track, int other);
+    bool nearPocket(const cv::Point2f& position) const;
+
+    std::vector<Track> tracks_;
+    std::vector<cv::Point2f> pockets_;
+    std::vector<BallEvent> events_;
+    std::vector<Shot> shots_;
+    cv::Size area_;                 // size of the minimap
+    CellGrid ball_grid_;
+    CellGrid track_grid_;
+
+    int next_id_ = 0;
+    int last_frame_ = -1;
+    int shot_start_ = -1;
+    int last_motion_ = -1;
+
+    // Thresholds in minimap pixels and frames
+    float max_speed_ = 60.0f;        // maximum displacement per frame to match a ball
+    float motion_speed_ = 1.5f;      // minimum speed of a moving ball
+    float collision_dv_ = 4.0f;      // minimum change of velocity for a collision
+    float contact_dist_ = 36.0f;     // maximum distance between two colliding balls
+    float pocket_dist_ = 40.0f;      // maximum distance from a pocket of a pocketed ball
+    int pocket_frames_ = 5;          // frames a ball must be missing to be pocketed
+    int lost_frames_ = 30;           // frames after which a missing ball is dropped
+    int rest_frames_ = 15;           // frames without motion that end a shot
+
+};
+
+
+#endif //EVENTDETECTION_H
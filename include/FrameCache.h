@@ -0,0 +1,43 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+#include "header.h"
+#include <cstdint>
+
+// Header of a frame cache, the frames follow at kFrameCacheDataOffset as raw BGR rows
+struct FrameCacheHeader {
+    char magic[4];                  // "SVAF"
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t start;                  // index of the first frame in the video
+    int32_t stride;                 // frames of the video between two cached frames
+    int32_t requested;              // number of frames asked for, more than count when the video ended
+    int32_t count;                  // number of cached frames
+    double fps;
+};
+
+// Frames of a video range decoded once into a file and mapped in memory, so that many runs of the
+// detector can read them without decoding the video again. The mapping is read-only and shared by
+// all the threads: the detection must not write into a frame, which would fault.
+class FrameCache {
+
+public:
+    ~FrameCache();
+    // Function to decode the frames start, start + stride, ... of a video into a cache file
+    static bool build(const std::string& video_path, const std::string& path, int start, int count, int stride);
+    bool open(const std::string& path);
+    void close();
+
+    int size() const { return header_ ? header_->count : 0; }
+    const FrameCacheHeader& header() const { return *header_; }
+    int frameIndex(int i) const { return header_->start + i * header_->stride; }
+    cv::Mat frame(int i) const;
+
+private:
+    void* memory_ = nullptr;
+    size_t bytes_ = 0;
+    const FrameCacheHeader* header_ = nullptr;
+};
+
+
+#endif //FRAMECACHE_H
@@ -0,0 +1,47 @@
+#ifndef FRAMECONTEXT_H
+#define FRAMECONTEXT_H
+#include "header.h"
+#include "TableSpans.h"
+#include "DetectorConfig.h"
+
+// Planes derived from the frame being analysed. Each plane is computed the first time it is
+// requested and shared read-only by the stages and by the balls of the frame; the buffers are
+// kept between frames, so that a frame of the same size does not allocate any memory.
+class FrameContext {
+
+public:
+    // Function to start a new frame, the spans of the table limit the table planes and the
+    // configuration gives the parameters of the blur and of the edges
+    void reset(const cv::Mat& frame, const TableSpans& spans, const DetectorConfig& config);
+
+    const cv::Mat& frame() const { return frame_; }
+    const TableSpans& spans() const { return *spans_; }
+    const cv::Rect& roi() const { return spans_->roi; }
+    const DetectorConfig& config() const { return *config_; }
+
+    // Planes of the whole frame
+    const cv::Mat& gray();          // grayscale
+    const cv::Mat& red();           // red channel
+
+    // Planes of the table, of the size of the roi and zero outside the table
+    const cv::Mat& tableGray();     // grayscale
+    const cv::Mat& blurred();       // median and gaussian blur of the grayscale
+    const cv::Mat& edges();         // Canny edges of the blurred grayscale
+
+    // Pixels of the table only, in a single column in the order of the spans
+    const cv::Mat& packedTable();   // color
+    const cv::Mat& packedGray();    // grayscale
+    const cv::Mat& xyz();           // XYZ color space, for the cloth colour model
+
+private:
+    enum Plane { GRAY, RED, TABLE_GRAY, BLURRED, EDGES, PACKED_TABLE, PACKED_GRAY, XYZ, PLANES };
+
+    cv::Mat frame_;
+    const TableSpans* spans_ = nullptr;
+    const DetectorConfig* config_ = nullptr;
+    cv::Mat planes_[PLANES];
+    bool ready_[PLANES] = {};
+};
+
+
+#endif //FRAMECONTEXT_H
@@ -0,0 +1,115 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum LogLevel {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_WARN = 2,
+    LOG_LEVEL_ERROR = 3
+};
+
+// Log calls below this level are removed at compile time
+#ifndef SVA_LOG_MIN_LEVEL
+#define SVA_LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#if defined(__GNUC__)
+#define SVA_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define SVA_PRINTF_FORMAT(fmt, args)
+#endif
+
+// One formatted message with its context
+struct LogRecord {
+    int64_t time_us;        // microseconds since the start of the logger
+    int level;
+    int frame;              // frame being processed, -1 when not set
+    int ball;               // ball being processed, -1 when not set
+    char message[200];
+};
+
+// Logger that formats the messages on the calling thread into a lock-free ring owned by that
+// thread. A background thread drains the rings and writes the messages to stderr, so the frame
+// loop never waits for the output. When a ring is full the message is dropped and counted. The
+// ring of a thread is freed after the thread exits.
+class Logger {
+
+public:
+    static Logger& instance();
+    ~Logger();
+
+    void write(int level, const char* format, ...) SVA_PRINTF_FORMAT(3, 4);
+    void setLevel(int level) { level_.store(level, std::memory_order_relaxed); }
+    bool enabled(int level) const { return level >= level_.load(std::memory_order_relaxed); }
+    void flush();
+
+    // Context of the messages of the calling thread
+    static void setFrame(int frame);
+    static void setBall(int ball);
+    static int frame();
+    static int ball();
+
+    // Messages of one thread
+    struct Ring {
+        static constexpr uint32_t kSize = 1024;     // power of two
+        LogRecord records[kSize];
+        std::atomic<uint32_t> head{0};              // written by the producer thread
+        std::atomic<uint32_t> tail{0};              // written by the background thread
+        std::atomic<uint32_t> dropped{0};
+        std::atomic<bool> retired{false};           // set when the producer thread exits
+    };
+
+private:
+    Logger();
+    Ring* localRing();
+    size_t drain();
+    void run();
+
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::mutex rings_mutex_;                        // only taken to register a thread or to drain
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> running_{true};
+    std::atomic<int> level_{LOG_LEVEL_INFO};
+    std::chrono::steady_clock::time_point start_;
+    std::thread worker_;
+};
+
+// Context of the messages of the calling thread for the lifetime of the object
+class LogScope {
+public:
+    explicit LogScope(int frame, int ball = -1) : prev_frame_(Logger::frame()), prev_ball_(Logger::ball()) {
+        Logger::setFrame(frame);
+        Logger::setBall(ball);
+    }
+    ~LogScope() {
+        Logger::setFrame(prev_frame_);
+        Logger::setBall(prev_ball_);
+    }
+
+private:
+    int prev_frame_;
+    int prev_ball_;
+};
+
+#define SVA_LOG(level, ...) \
+    do { \
+        if ((level) >= SVA_LOG_MIN_LEVEL && Logger::instance().enabled(level)) \
+            Logger::instance().write((level), __VA_ARGS__); \
+    } while (0)
+
+#define SVA_DEBUG(...) SVA_LOG(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define SVA_INFO(...) SVA_LOG(LOG_LEVEL_INFO, __VA_ARGS__)
+#define SVA_WARN(...) SVA_LOG(LOG_LEVEL_WARN, __VA_ARGS__)
+#define SVA_ERROR(...) SVA_LOG(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+
+#endif //LOGGER_H
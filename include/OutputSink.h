@@ -0,0 +1,76 @@
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+#include "header.h"
+#include <cstdio>
+#include <memory>
+
+// Destination of the composed output frames
+class OutputSink {
+
+public:
+    virtual ~OutputSink() = default;
+    virtual bool open(const std::string& path, double fps, const cv::Size& size) = 0;
+    virtual bool write(const cv::Mat& frame, int frame_index) = 0;
+    virtual void close() = 0;
+
+};
+
+// Encode the frames in a video file with cv::VideoWriter
+class VideoWriterSink : public OutputSink {
+public:
+    explicit VideoWriterSink(const std::string& codec);
+    bool open(const std::string& path, double fps, const cv::Size& size) override;
+    bool write(const cv::Mat& frame, int frame_index) override;
+    void close() override;
+
+private:
+    cv::VideoWriter writer_;
+    int fourcc_;
+    cv::Size size_;
+};
+
+// Save each frame as an image named after its frame index
+class ImageSequenceSink : public OutputSink {
+public:
+    ImageSequenceSink(const std::string& extension, int compression);
+    bool open(const std::string& path, double fps, const cv::Size& size) override;
+    bool write(const cv::Mat& frame, int frame_index) override;
+    void close() override;
+
+private:
+    std::string prefix_;
+    std::string extension_;
+    std::vector<int> params_;
+};
+
+// Write the raw frames to stdout (path "-") or to a file, for an external encoder
+class PipeSink : public OutputSink {
+public:
+    enum Format { RAW_BGR, Y4M };
+
+    explicit PipeSink(Format format);
+    ~PipeSink() override;
+    bool open(const std::string& path, double fps, const cv::Size& size) override;
+    bool write(const cv::Mat& frame, int frame_index) override;
+    void close() override;
+
+private:
+    Format format_;
+    FILE* file_ = nullptr;
+    cv::Mat yuv_;
+};
+
+// Discard the frames, to measure the analysis without any encoding
+class NullSink : public OutputSink {
+public:
+    bool open(const std::string& path, double fps, const cv::Size& size) override { return true; }
+    bool write(const cv::Mat& frame, int frame_index) override { return true; }
+    void close() override {}
+};
+
+std::unique_ptr<OutputSink> createSink(const std::string& type, const std::string& codec, int compression);
+std::string outputName(const std::string& output_path, const std::string& suffix);
+std::string segmentName(const std::string& output_path, int segment);
+
+
+#endif //OUTPUTSINK_H
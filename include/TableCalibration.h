@@ -0,0 +1,25 @@
+#ifndef TABLECALIBRATION_H
+#define TABLECALIBRATION_H
+#include "header.h"
+
+// Table geometry and cloth colour model of a fixed camera, saved between runs
+struct TableCalibration {
+    int version = 0;                            // format of the file, older files are detected again
+    cv::Size frame_size;
+    cv::Mat fingerprint;                        // small grayscale thumbnail of the first frame
+    std::vector<cv::Point2f> corners;           // table corners in the order of TableDetection::tableCorners_
+    std::vector<cv::Point2f> sorted_corners;    // table polygon: top-left, top-right, bottom-right, bottom-left
+    cv::Mat homography;                         // perspective transformation from the frame to the minimap
+    cv::Mat cloth_centers;                      // KMeans cluster centers in the XYZ color space
+
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+    void read(const cv::FileStorage& fs);
+    void write(cv::FileStorage& fs) const;
+    bool matches(const cv::Mat& firstFrame) const;
+    bool isCurrent() const;
+    static cv::Mat computeFingerprint(const cv::Mat& frame);
+};
+
+
+#endif //TABLECALIBRATION_H
@@ -0,0 +1,28 @@
+#ifndef TABLESPANS_H
+#define TABLESPANS_H
+#include "header.h"
+
+// Table region stored as one interval of columns per row of its bounding rectangle. The table
+// polygon is convex, so each row of the table is a single run of pixels; the stages iterate over
+// these runs instead of the whole rectangle, a large part of which is outside the table.
+struct TableSpans {
+    cv::Rect roi;                   // bounding rectangle of the table in the frame
+    std::vector<cv::Vec2i> spans;   // per row of the roi: columns [begin, end) relative to the roi
+    int area = 0;                   // number of pixels of the table
+
+    // Function to build the spans from the mask of the table drawn in the frame
+    void build(const cv::Mat& table_mask, const cv::Rect& rect);
+    bool empty() const { return area == 0; }
+
+    // Function to copy the table pixels of an image of the frame size into an image of the size
+    // of the roi, zero outside the table
+    void copy(const cv::Mat& src, cv::Mat& dst) const;
+    // Function to gather the table pixels of an image of the frame size in a single column
+    void pack(const cv::Mat& src, cv::Mat& packed) const;
+    // Function to scatter a column of table pixels into an image of the size of the roi,
+    // the pixels outside the table are set to fill
+    void unpack(const cv::Mat& packed, cv::Mat& dst, const cv::Scalar& fill) const;
+};
+
+
+#endif //TABLESPANS_H
@@ -0,0 +1,15 @@
+#ifndef TILEFILTER_H
+#define TILEFILTER_H
+#include "header.h"
+#include <functional>
+
+// Filter applied on one tile, the output must have the size of the input tile
+typedef std::function<void(const cv::Mat& src, cv::Mat& dst)> TileFunction;
+
+// Function to apply a chain of neighbourhood filters on horizontal tiles of the image in parallel.
+// Each tile is extended by halo rows on both sides, which must cover the vertical reach of the
+// whole chain, so that the rows kept from every tile are identical to filtering the whole image.
+void parallelTileFilter(const cv::Mat& src, cv::Mat& dst, int halo, const TileFunction& filter);
+
+
+#endif //TILEFILTER_H
@@ -9,6 +9,8 @@
 #include <opencv2/xfeatures2d.hpp>
 #include <fstream>
 #include <algorithm>
+#include <limits>
+#include "Logger.h"
 
 
 #endif //HEADER_H
@@ -0,0 +1,153 @@
+/*
+ * File:    AnalysisCache.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the analysis cache. The first run saves the
+ *             table geometry and the balls of every analysed frame (centers, radii, labels and tracks)
+ *             in a binary file, so that the output video and the minimap can be rendered again with
+ *             different settings by only decoding the frames, without running the detection.
+ */
+
+#include "../include/AnalysisCache.h"
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint32_t kAnalysisCacheVersion = 2;
+
+AnalysisCacheWriter::~AnalysisCacheWriter() {
+    close();
+}
+
+bool AnalysisCacheWriter::open(const std::string& path, const AnalysisInfo& info, bool append) {
+    close();
+    // A resumed run continues the cache of the interrupted run, without the partial record
+    // of a run killed while writing
+    struct stat st;
+    if (append && stat(path.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(AnalysisCacheHeader)) {
+        size_t records = (static_cast<size_t>(st.st_size) - sizeof(AnalysisCacheHeader)) / sizeof(BallFrameState);
+        if (truncate(path.c_str(), static_cast<off_t>(sizeof(AnalysisCacheHeader) + records * sizeof(BallFrameState))) == 0) {
+            file_ = std::fopen(path.c_str(), "ab");
+            if (file_ != nullptr) return true;
+        }
+    }
+    file_ = std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        SVA_ERROR("Could not create the analysis cache %s", path.c_str());
+        return false;
+    }
+
+    AnalysisCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SVAC", 4);
+    header.version = kAnalysisCacheVersion;
+    header.record_size = sizeof(BallFrameState);
+    header.frame_width = info.frame_size.width;
+    header.frame_height = info.frame_size.height;
+    header.start = info.start;
+    header.stride = info.stride;
+    header.map_width = info.map_size.width;
+    header.map_height = info.map_size.height;
+    header.fps = info.fps;
+    for (size_t i = 0; i < 4 && i < info.corners.size(); i++) {
+        header.corners[2 * i] = info.corners[i].x;
+        header.corners[2 * i + 1] = info.corners[i].y;
+    }
+    for (size_t i = 0; i < 4 && i < info.sorted_corners.size(); i++) {
+        header.sorted_corners[2 * i] = info.sorted_corners[i].x;
+        header.sorted_corners[2 * i + 1] = info.sorted_corners[i].y;
+    }
+    if (info.homography.total() == 9) {
+        cv::Mat h;
+        info.homography.convertTo(h, CV_64F);
+        for (int i = 0; i < 9; i++) header.homography[i] = h.at<double>(i / 3, i % 3);
+    }
+    if (std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+        SVA_ERROR("Could not write the analysis cache %s", path.c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool AnalysisCacheWriter::write(const BallFrameState& balls) {
+    if (file_ == nullptr) return false;
+    return std::fwrite(&balls, sizeof(BallFrameState), 1, file_) == 1;
+}
+
+bool AnalysisCacheWriter::flush() {
+    if (file_ == nullptr) return false;
+    return std::fflush(file_) == 0 && !std::ferror(file_);
+}
+
+void AnalysisCacheWriter::close() {
+    if (file_ == nullptr) return;
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+
+AnalysisCacheReader::~AnalysisCacheReader() {
+    close();
+}
+
+bool AnalysisCacheReader::open(const std::string& path) {
+    close();
+    file_ = std::fopen(path.c_str(), "rb");
+    if (file_ == nullptr) {
+        SVA_ERROR("Could not open the analysis cache %s", path.c_str());
+        return false;
+    }
+    AnalysisCacheHeader header;
+    if (std::fread(&header, sizeof(header), 1, file_) != 1 || std::memcmp(header.magic, "SVAC", 4) != 0 ||
+        header.version != kAnalysisCacheVersion || header.record_size != sizeof(BallFrameState)) {
+        SVA_ERROR("%s is not a compatible analysis cache", path.c_str());
+        close();
+        return false;
+    }
+
+    info_ = AnalysisInfo();
+    info_.frame_size = cv::Size(header.frame_width, header.frame_height);
+    info_.start = header.start;
+    info_.stride = header.stride;
+    info_.map_size = cv::Size(header.map_width, header.map_height);
+    info_.fps = header.fps;
+    for (int i = 0; i < 4; i++) {
+        info_.corners.emplace_back(header.corners[2 * i], header.corners[2 * i + 1]);
+        info_.sorted_corners.emplace_back(header.sorted_corners[2 * i], header.sorted_corners[2 * i + 1]);
+    }
+    info_.homography = cv::Mat(3, 3, CV_64F);
+    for (int i = 0; i < 9; i++) info_.homography.at<double>(i / 3, i % 3) = header.homography[i];
+
+    has_next_ = false;
+    readNext();
+    return true;
+}
+
+// Function to read the next record, the records of the frames already read are repeated
+// when a run was resumed from a checkpoint and are skipped
+bool AnalysisCacheReader::readNext() {
+    int last = has_next_ ? next_.frame : -1;
+    has_next_ = false;
+    BallFrameState record;
+    while (file_ != nullptr && std::fread(&record, sizeof(BallFrameState), 1, file_) == 1) {
+        if (record.frame <= last || record.count < 0 || record.count > BallFrameState::kCapacity) continue;
+        std::memcpy(&next_, &record, sizeof(BallFrameState));
+        has_next_ = true;
+        return true;
+    }
+    return false;
+}
+
+bool AnalysisCacheReader::read(int frame, BallFrameState& balls) {
+    while (has_next_ && next_.frame < frame) readNext();
+    if (!has_next_ || next_.frame != frame) return false;
+    std::memcpy(&balls, &next_, sizeof(BallFrameState));
+    readNext();
+    return true;
+}
+
+void AnalysisCacheReader::close() {
+    if (file_ == nullptr) return;
+    std::fclose(file_);
+    file_ = nullptr;
+}
@@ -0,0 +1,30 @@
+/*
+ * File:    ArgParse.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the parsing of the numeric command line arguments shared by Starter
+ *             and ParamSweep. A value is only accepted when the whole argument is a number in range,
+ *             so that a typo is reported instead of being read as 0.
+ */
+
+#include "../include/ArgParse.h"
+#include <cerrno>
+#include <climits>
+#include <cmath>
+
+bool parseInt(const char* text, int min_value, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < min_value || parsed > INT_MAX) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+bool parseDouble(const char* text, double min_value, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !std::isfinite(parsed) || parsed < min_value) return false;
+    value = parsed;
+    return true;
+}
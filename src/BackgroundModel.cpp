@@ -0,0 +1,121 @@
+/*
+ * File:    BackgroundModel.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the background model of the table. The model
+ *             is the median color of each table pixel over frames sampled across the video, without the
+ *             balls detected in each frame, and it follows slow changes of the light by moving one level
+ *             at a time towards the background pixels. The balls are the pixels that differ from the
+ *             model, found with a single comparison over the table pixels. A foreground spot that stays
+ *             the same for a long time, such as the place left by a ball that moved, joins the model.
+ */
+
+#include "../include/BackgroundModel.h"
+
+bool BackgroundModel::build(const std::vector<cv::Mat>& frames, const std::vector<cv::Mat>& masks, const TableSpans& spans) {
+    model_.release();
+    age_.release();
+    previous_.release();
+    frames_ = 0;
+    if (frames.size() < 3 || frames.size() != masks.size() || spans.empty()) return false;
+
+    // Table pixels of each frame, one row per pixel and one column per channel
+    std::vector<cv::Mat> samples, excluded;
+    for (size_t s = 0; s < frames.size(); s++) {
+        cv::Mat packed, packed_mask;
+        spans.pack(frames[s], packed);
+        spans.pack(masks[s], packed_mask);
+        samples.push_back(packed.reshape(1, spans.area));
+        excluded.push_back(packed_mask);
+    }
+
+    // Per-pixel median of the samples where the pixel is not covered by a ball
+    model_.create(spans.area, 3, CV_8UC1);
+    cv::Mat known(spans.area, 1, CV_8UC1);
+    size_t count = samples.size();
+    cv::parallel_for_(cv::Range(0, spans.area), [&](const cv::Range& range) {
+        std::vector<uchar> values(count);
+        for (int i = range.start; i < range.end; i++) {
+            size_t n = 0;
+            for (int c = 0; c < 3; c++) {
+                n = 0;
+                for (size_t s = 0; s < count; s++) {
+                    if (excluded[s].at<uchar>(i) == 0) values[n++] = samples[s].at<uchar>(i, c);
+                }
+                if (n > 0) std::nth_element(values.begin(), values.begin() + n / 2, values.begin() + n);
+                model_.at<uchar>(i, c) = n > 0 ? values[n / 2] : 0;
+            }
+            known.at<uchar>(i) = n > 0 ? 255 : 0;
+        }
+    });
+
+    // The pixels covered by a ball in every sample take the median color of the cloth
+    int covered = spans.area - cv::countNonZero(known);
+    if (covered == spans.area) return false;
+    if (covered > 0) {
+        uchar color[3];
+        for (int c = 0; c < 3; c++) {
+            std::vector<uchar> values;
+            values.reserve(spans.area - covered);
+            for (int i = 0; i < spans.area; i++) {
+                if (known.at<uchar>(i) != 0) values.push_back(model_.at<uchar>(i, c));
+            }
+            std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+            color[c] = values[values.size() / 2];
+        }
+        for (int i = 0; i < spans.area; i++) {
+            if (known.at<uchar>(i) != 0) continue;
+            for (int c = 0; c < 3; c++) model_.at<uchar>(i, c) = color[c];
+        }
+        SVA_DEBUG("%d table pixels covered by a ball in every sample", covered);
+    }
+    age_ = cv::Mat::zeros(spans.area, 1, CV_16UC1);
+    return true;
+}
+
+cv::Mat BackgroundModel::foreground(FrameContext& context) {
+    const TableSpans& spans = context.spans();
+    cv::Mat mask;
+    if (!ready() || model_.rows != spans.area) return cv::Mat::zeros(spans.roi.size(), CV_8UC1);
+
+    // A pixel is foreground when one of its channels differs from the model
+    cv::Mat packed = context.packedTable().reshape(1, spans.area);
+    cv::absdiff(packed, model_, diff_);
+    cv::reduce(diff_, max_diff_, 1, cv::REDUCE_MAX);
+    int threshold = context.config().background_threshold;
+    cv::compare(max_diff_, threshold, packed_fg_, cv::CMP_GT);
+
+    // Age of the foreground pixels that did not change since the previous frame, the others restart.
+    // The pixels that reach background_absorb frames are copied into the model
+    if (previous_.size() == packed.size()) {
+        cv::absdiff(packed, previous_, diff_);
+        cv::reduce(diff_, max_diff_, 1, cv::REDUCE_MAX);
+        cv::compare(max_diff_, threshold, still_, cv::CMP_LE);
+        cv::bitwise_and(still_, packed_fg_, still_);
+        cv::add(age_, cv::Scalar(1), age_, still_);
+        cv::bitwise_not(still_, still_);
+        age_.setTo(0, still_);
+        cv::compare(age_, context.config().background_absorb, absorb_, cv::CMP_GE);
+        if (cv::countNonZero(absorb_) > 0) {
+            cv::repeat(absorb_, 1, 3, fg3_);
+            packed.copyTo(model_, fg3_);
+            age_.setTo(0, absorb_);
+            cv::bitwise_not(absorb_, absorb_);
+            cv::bitwise_and(packed_fg_, absorb_, packed_fg_);
+        }
+    }
+    packed.copyTo(previous_);
+    spans.unpack(packed_fg_, mask, cv::Scalar(0));
+
+    // Move the background pixels of the model one level towards the frame
+    if (++frames_ % update_interval_ == 0) {
+        cv::repeat(packed_fg_, 1, 3, fg3_);
+        cv::bitwise_not(fg3_, fg3_);
+        cv::compare(packed, model_, up_, cv::CMP_GT);
+        cv::compare(packed, model_, down_, cv::CMP_LT);
+        cv::bitwise_and(up_, fg3_, up_);
+        cv::bitwise_and(down_, fg3_, down_);
+        cv::add(model_, cv::Scalar(1), model_, up_);
+        cv::subtract(model_, cv::Scalar(1), model_, down_);
+    }
+    return mask;
+}
@@ -0,0 +1,97 @@
+/*
+ * File:    BallCache.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the cache of the refined balls. Most of the
+ *             balls are at rest in most frames: the refined circles, the confidence and the color norm
+ *             of a candidate are kept with a grayscale patch of its balls, and reused while the sum of
+ *             absolute differences with the patch of the new frame stays small.
+ */
+
+#include "../include/BallCache.h"
+
+void BallCache::clear() {
+    entries_.clear();
+    frame_ = 0;
+    reused_ = 0;
+    refined_ = 0;
+}
+
+void BallCache::beginFrame() {
+    frame_++;
+    // Drop the balls that are not on the table any more
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [this](const BallCacheEntry& e) {
+        return frame_ - e.last_seen > max_age_;
+    }), entries_.end());
+    for (auto& entry : entries_) entry.indices.clear();
+}
+
+BallCacheEntry* BallCache::find(const cv::Point2f& candidate) {
+    BallCacheEntry* nearest = nullptr;
+    float best = max_distance_;
+    for (auto& entry : entries_) {
+        float dist = std::hypot(entry.candidate.x - candidate.x, entry.candidate.y - candidate.y);
+        if (dist <= best) {
+            best = dist;
+            nearest = &entry;
+        }
+    }
+    return nearest;
+}
+
+bool BallCache::reuse(const cv::Point2f& candidate, const cv::Mat& gray, BallFrameState& balls) {
+    BallCacheEntry* entry = find(candidate);
+    if (entry == nullptr || !entry->indices.empty()) return false;
+
+    // Mean absolute difference over the box of the balls
+    double difference = cv::norm(gray(entry->box), entry->patch, cv::NORM_L1) / static_cast<double>(entry->box.area());
+    if (difference > max_difference_) return false;
+
+    entry->last_seen = frame_;
+    for (const auto& ball : entry->balls) {
+        int i = balls.push(ball.x, ball.y, ball.radius, ball.confidence);
+        if (i < 0) break;
+        balls.norm[i] = ball.norm;
+        entry->indices.push_back(i);
+    }
+    reused_++;
+    return true;
+}
+
+void BallCache::store(const cv::Point2f& candidate, const cv::Mat& gray, const BallFrameState& balls, int first) {
+    refined_++;
+    if (first >= balls.size()) return;
+
+    // A candidate near an entry already used in this frame adds its balls to that entry,
+    // otherwise it replaces the entry of the same candidate or creates a new one
+    BallCacheEntry* previous = find(candidate);
+    BallCacheEntry entry;
+    bool merge = previous != nullptr && !previous->indices.empty();
+    if (merge) entry = *previous;
+    entry.candidate = merge ? previous->candidate : candidate;
+    entry.last_seen = frame_;
+    cv::Rect box = merge ? previous->box : cv::Rect();
+    for (int i = first; i < balls.size(); i++) {
+        entry.balls.push_back({balls.x[i], balls.y[i], balls.radius[i], balls.confidence[i], balls.norm[i]});
+        entry.indices.push_back(i);
+        float r = balls.radius[i] + 2;
+        cv::Rect ball_box(cvFloor(balls.x[i] - r), cvFloor(balls.y[i] - r), cvCeil(2 * r) + 1, cvCeil(2 * r) + 1);
+        box = box.area() == 0 ? ball_box : (box | ball_box);
+    }
+    entry.box = box & cv::Rect(0, 0, gray.cols, gray.rows);
+    if (entry.box.area() == 0) return;
+    entry.patch = gray(entry.box).clone();
+
+    if (previous != nullptr) {
+        *previous = entry;
+    } else {
+        entries_.push_back(entry);
+    }
+}
+
+void BallCache::commit(const BallFrameState& balls) {
+    for (auto& entry : entries_) {
+        for (size_t k = 0; k < entry.indices.size() && k < entry.balls.size(); k++) {
+            if (entry.indices[k] < balls.size()) entry.balls[k].norm = balls.norm[entry.indices[k]];
+        }
+    }
+}
@@ -10,78 +10,183 @@
  */
 
 #include "BallDetection.h"
+#include "TileFilter.h"
 
 BallDetection::BallDetection() = default;
 
-// Function to remove groups of pixels with area less than rmp
-cv::Mat BallDetection::removePixel(cv::Mat img, int rmp)
+// Function to remove groups of pixels with area greater than rmp. With the spans of the table,
+// only the table pixels are kept and visited
+cv::Mat BallDetection::removePixel(cv::Mat img, int rmp, const TableSpans* spans)
 {
-    cv::Mat labels;
-    int num_components = cv::connectedComponents(img, labels);
+    cv::Mat labels, stats, centroids;
+    int num_components = cv::connectedComponentsWithStats(img, labels, stats, centroids);
 
+    // Components to remove, found from their area in a single labelling pass
     int min_size = rmp;
+    std::vector<uchar> remove(num_components, 0);
     for (int i = 1; i < num_components; i++) {
-        cv::Mat component_mask = (labels == i);
-        int area = cv::countNonZero(component_mask);
-        if (area > min_size) {
-            img.setTo(0, component_mask);
-        }
+        remove[i] = stats.at<int>(i, cv::CC_STAT_AREA) > min_size;
+    }
 
+    for (int y = 0; y < img.rows; y++) {
+        uchar* row = img.ptr<uchar>(y);
+        const int* label = labels.ptr<int>(y);
+        int begin = 0, end = img.cols;
+        if (spans != nullptr) {
+            begin = spans->spans[y][0];
+            end = spans->spans[y][1];
+            std::fill(row, row + begin, 0);
+            std::fill(row + end, row + img.cols, 0);
+        }
+        for (int x = begin; x < end; x++) {
+            if (remove[label[x]]) row[x] = 0;
+        }
     }
     return img;
 }
 
 
 // Function to create a mask to detect balls on the table
-bool BallDetection::processTableObjects(const cv::Mat& frame, const cv::Rect& roiRect) {
-    // Extract the region of interest
-    cv::Mat roi = frame(roiRect).clone();
+bool BallDetection::processTableObjects(FrameContext& context) {
+    cv::Mat km;
+    double t_mask = static_cast<double>(cv::getTickCount());
+    if (use_background_) {
+        // Pixels that differ from the empty table
+        km = background_.foreground(context);
+        background_ticks_ += static_cast<double>(cv::getTickCount()) - t_mask;
+        if (verify_background_) {
+            double t_reference = static_cast<double>(cv::getTickCount());
+            cv::Mat reference = tableObjectMask(context);
+            mask_ticks_ += static_cast<double>(cv::getTickCount()) - t_reference;
+            compareBackground(context, km, reference);
+        }
+    } else {
+        km = tableObjectMask(context);
+        mask_ticks_ += static_cast<double>(cv::getTickCount()) - t_mask;
+    }
+
+    centers_ = maskCenters(context, km);
+    if (centers_.empty()) {
+        SVA_ERROR("No circles detected!");
+        return false;
+    }
+
+    return true;
+
+}
 
+// Function to find the centers of the balls in the grayscale table, only where the mask is set
+std::vector<cv::Point2f> BallDetection::maskCenters(FrameContext& context, const cv::Mat& mask) {
+    cv::Mat final_mask = cv::Mat::zeros(context.frame().size(), CV_8UC1);
+    context.tableGray().copyTo(final_mask(context.roi()), mask);
+    findCenters fc(this);
+    return fc.findCenter(final_mask);
+}
+
+// Function to compare the foreground of the background model with the mask of tableObjectMask:
+// overlap of the masks and share of the centers of the reference found within 5 pixels
+void BallDetection::compareBackground(FrameContext& context, const cv::Mat& foreground, const cv::Mat& reference) {
+    cv::Mat both, any;
+    cv::bitwise_and(foreground, reference, both);
+    cv::bitwise_or(foreground, reference, any);
+    int union_area = cv::countNonZero(any);
+    double iou = union_area > 0 ? static_cast<double>(cv::countNonZero(both)) / union_area : 1.0;
+
+    std::vector<cv::Point2f> found = maskCenters(context, foreground);
+    std::vector<cv::Point2f> expected = maskCenters(context, reference);
+    int matched = 0;
+    for (const auto& e : expected) {
+        for (const auto& f : found) {
+            if (std::hypot(e.x - f.x, e.y - f.y) <= 5.0f) {
+                matched++;
+                break;
+            }
+        }
+    }
+    SVA_DEBUG("Background mask IoU %.3f, %d of %d centers, %d found", iou, matched,
+              static_cast<int>(expected.size()), static_cast<int>(found.size()));
+    iou_sum_ += iou;
+    verified_frames_++;
+    centers_matched_ += matched;
+    centers_expected_ += static_cast<int>(expected.size());
+}
+
+// Function to create the mask of the table objects from the KMeans segmentation of the cloth
+// and the contours of the edges, without the large blobs
+cv::Mat BallDetection::tableObjectMask(FrameContext& context) {
     // Apply KMeans to segment the image
     TableDetection vp(this);
-    cv::Mat km = vp.KMeans(roi);
-
-    // Convert the image to grayscale
-    cv::Mat gray;
-    cv::cvtColor(roi, gray, cv::COLOR_BGR2GRAY);
-    // Apply Median Blur to reduce noise and Gaussian Blur to smooth the image
-    cv::medianBlur(gray, gray, 7);
-    cv::GaussianBlur(gray, gray, cv::Size(0, 0), 2);
-    // Apply Canny Edge Detection
-    cv::Mat edges;
-    cv::Canny(gray, edges, 50, 100);
+    cv::Mat km = vp.KMeans(context);
+
+    // Create a mask for the contours of the table objects
+    double t_contours = static_cast<double>(cv::getTickCount());
+    cv::Mat mask_ctr = contourMask(context);
+    contour_ticks_ += static_cast<double>(cv::getTickCount()) - t_contours;
+
+    // Compare the mask with the one of the untiled chain
+    if (verify_mask_) {
+        double t_reference = static_cast<double>(cv::getTickCount());
+        cv::Mat reference = referenceContourMask(context.tableGray());
+        reference_ticks_ += static_cast<double>(cv::getTickCount()) - t_reference;
+        int diff = cv::countNonZero(mask_ctr != reference);
+        if (diff > 0) {
+            mask_mismatches_++;
+            SVA_WARN("The contour mask differs from the reference in %d pixels", diff);
+        }
+    }
+    // Combine the KMeans mask with the contours mask to improve the segmentation
+    cv::bitwise_or(mask_ctr, km, km);
+    // Remove groups of pixels with area larger than max_blob_area
+    removePixel(km, config_.max_blob_area, &context.spans());
+    return km;
+}
+
+// Function to create the mask of the contours of the table objects from the blurred grayscale table:
+// the Canny edges are closed, their contours are drawn with a thickness of 3 and dilated
+cv::Mat BallDetection::contourMask(FrameContext& context) {
+    // Apply Canny Edge Detection on the blurred grayscale table
+    const cv::Mat& edges = context.edges();
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(config_.close_size, config_.close_size));
+    cv::Mat kernel_dilate = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(config_.dilate_width, config_.dilate_height));
+    int iterations = config_.dilate_iterations;
+    // Rows needed around a tile by the closing and by the dilation
+    int close_halo = config_.close_size / 2 * 2;
+    int dilate_halo = config_.dilate_height / 2 * iterations;
+    cv::Mat mask_ctr;
+
     // Apply Morphological Closing to close the gaps in the edges
-    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
+    cv::Mat closed;
+    parallelTileFilter(edges, closed, close_halo, [&](const cv::Mat& src, cv::Mat& dst) {
+        cv::morphologyEx(src, dst, cv::MORPH_CLOSE, kernel);
+    });
+    // Find contours, all of them are drawn so their hierarchy is not needed
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(closed, contours, cv::RETR_LIST, cv::CHAIN_APPROX_SIMPLE);
+    cv::Mat drawn = cv::Mat::zeros(edges.size(), CV_8UC1);
+    cv::drawContours(drawn, contours, -1, cv::Scalar(255, 255, 255), 3);
+    // Apply Morphological Dilation to thicken the contours
+    parallelTileFilter(drawn, mask_ctr, dilate_halo, [&](const cv::Mat& src, cv::Mat& dst) {
+        cv::dilate(src, dst, kernel_dilate, cv::Point(-1, -1), iterations);
+    });
+    return mask_ctr;
+}
+
+// Function to create the mask of the contours with one full pass per filter, to verify contourMask
+cv::Mat BallDetection::referenceContourMask(const cv::Mat& gray) {
+    cv::Mat blurred;
+    cv::medianBlur(gray, blurred, config_.median_size);
+    cv::GaussianBlur(blurred, blurred, cv::Size(0, 0), config_.gaussian_sigma);
+    cv::Mat edges;
+    cv::Canny(blurred, edges, config_.canny_low, config_.canny_high);
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(config_.close_size, config_.close_size));
     cv::morphologyEx(edges, edges, cv::MORPH_CLOSE, kernel);
-    // Find contours
     std::vector<std::vector<cv::Point>> contours;
     cv::findContours(edges, contours, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
-    // Create a mask for the contours
-    cv::Mat mask_ctr = cv::Mat::zeros(roi.size(), CV_8UC1);
+    cv::Mat mask_ctr = cv::Mat::zeros(gray.size(), CV_8UC1);
     cv::drawContours(mask_ctr, contours, -1, cv::Scalar(255, 255, 255), 3);
-    // Apply Morphological Dilation to thicken the contours
-    cv::Mat kernel_dilate = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3,5));
-    cv::morphologyEx(mask_ctr, mask_ctr, cv::MORPH_DILATE, kernel_dilate, cv::Point(-1, -1), 2);
-    // Combine the KMeans mask with the contours mask to improve the segmentation
-    cv::bitwise_or(mask_ctr, km, km);
-    // Remove groups of pixels with area less than 3000
-    removePixel(km, 3000);
-    // Create a mask for the table
-    cv::Mat combined_mask = cv::Mat::zeros(frame.size(), CV_8UC1);
-    km.copyTo(combined_mask(roiRect));
-
-    // Combine the final mask with the original frame
-    cv::Mat final_mask;
-    cv::bitwise_and(frame, frame, final_mask, combined_mask);
-    findCenters fc(this);
-    centers_ = fc.findCenter(final_mask);
-    if (centers_.empty()) {
-        std::cerr << "Error: No circles detected!" << std::endl;
-        return false;
-    }
-
-    return true;
-
+    cv::Mat kernel_dilate = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(config_.dilate_width, config_.dilate_height));
+    cv::morphologyEx(mask_ctr, mask_ctr, cv::MORPH_DILATE, kernel_dilate, cv::Point(-1, -1), config_.dilate_iterations);
+    return mask_ctr;
 }
 
 // Function to transform a point using a perspective transformation matrix
@@ -104,61 +209,56 @@ cv::Mat BallDetection::create_table(int width, int height) {
 
 
 // Function to draw balls on the table
-cv::Mat BallDetection::draw_balls(const std::vector<cv::Point2f>& minimapBallPositions, const cv::Mat& background, int radius = 7, int size = -1, const cv::Mat& img = cv::Mat()) {
+cv::Mat BallDetection::draw_balls(const cv::Mat& background, int radius = 7, int size = -1) {
     cv::Mat final = background.clone(); // canvas
-    std::vector<double> l2_norms(minimapBallPositions.size(), 0.0);
-
-    // Calculate the mean color and L2 norm for each position
-    for (size_t i = 0; i < minimapBallPositions.size(); ++i) {
-        cv::Point2f position = minimapBallPositions[i];
-
-        float cX = position.x;
-        float cY = position.y;
 
-        cv::Mat mask = cv::Mat::zeros(img.size(), CV_8UC1);
-        cv::circle(mask, cv::Point2f(cX, cY), radius_[i], cv::Scalar(255), -1);
-
-        cv::Scalar meanColor = cv::mean(img, mask);
-
-        // Calculate L2 norm of the mean color
-        double l2_norm = cv::norm(meanColor);
-        l2_norms[i] = l2_norm;
-    }
-
-    // Find the min and max L2 norm values
-    auto minmax = std::minmax_element(l2_norms.begin(), l2_norms.end());
-    double min_val = *minmax.first;
-    double max_val = *minmax.second;
-
-    // Draw the balls with assigned colors based on L2 norms
-    for (size_t i = 0; i < minimapBallPositions.size(); ++i) {
-//        cv::Point2f position = minimapBallPositions[i];
-        cv::Point2f position = minimapBallPositions[i];
+    // Colors of the balls, unknown balls are not drawn
+    cv::Scalar colors[BallFrameState::kCapacity];
+    bool known[BallFrameState::kCapacity];
+    for (int i = 0; i < balls_.size(); ++i) {
+        cv::Point2f position = balls_.mapCenter(i);
         int cX = static_cast<int>(position.x);
         int cY = static_cast<int>(position.y);
 
-        cv::Scalar color;
+        cv::Scalar& color = colors[i];
+        known[i] = false;
 
-        if (l2_norms[i] == max_val) {
+        if (balls_.label[i] == LABEL_WHITE) {
             color = cv::Scalar(255, 255, 255); // White color for max L2 norm
-        } else if (l2_norms[i] == min_val) {
+        } else if (balls_.label[i] == LABEL_BLACK) {
             color = cv::Scalar(0, 0, 0); // Black color for min L2 norm
-        } else if (l2_norms[i] < max_val && l2_norms[i] > 200) {
+        } else if (balls_.label[i] == LABEL_STRIPED) {
             color = cv::Scalar(255, 0, 0); // Blue color for L2 norm > 200
 
-        } else if (l2_norms[i] < 200 && l2_norms[i] > min_val) {
+        } else if (balls_.label[i] == LABEL_SOLID) {
             color = cv::Scalar(0, 0, 255); // Red color for L2 norm < 200
 
         } else {
-            std::cout << "No color detected" << std::endl;
+            LogScope scope(Logger::frame(), i);
+            SVA_WARN("No color detected");
             continue;
         }
+        // Fill the trajectory of the frames skipped by the stride
+        interpolateTrajectory(position);
         // Store the points to for tracking
         points_.push_back(cv::Point2f(cX, cY));
+        known[i] = true;
+    }
 
+    // Draw the trajectories once, below the balls
+    if (draw_trail_) {
         for (const auto& pt : points_) {
             cv::circle(final, pt, 2, cv::Scalar(0, 0, 0), -1);
         }
+    }
+
+    // Draw the balls with the colors of their labels
+    for (int i = 0; i < balls_.size(); ++i) {
+        if (!known[i]) continue;
+        int cX = static_cast<int>(balls_.map_x[i]);
+        int cY = static_cast<int>(balls_.map_y[i]);
+        const cv::Scalar& color = colors[i];
+
         // Draw the ball
         cv::circle(final, cv::Point(cX, cY), radius, color, size);
 
@@ -170,10 +270,43 @@ cv::Mat BallDetection::draw_balls(const std::vector<cv::Point2f>& minimapBallPos
 
     }
 
+    prev_minimap_.clear();
+    for (int i = 0; i < balls_.size(); ++i) {
+        prev_minimap_.push_back(balls_.mapCenter(i));
+    }
+
     return final;
 }
 
 
+// Function to add the trajectory points of the skipped frames between the nearest ball
+// of the previous analysed frame and the current position
+void BallDetection::interpolateTrajectory(const cv::Point2f& position) {
+    if (stride_ <= 1 || prev_minimap_.empty()) return;
+
+    // Find the nearest ball in the previous analysed frame
+    float max_dist = 40.0f * static_cast<float>(stride_);
+    float best_dist = max_dist;
+    const cv::Point2f* nearest = nullptr;
+    for (const auto& prev : prev_minimap_) {
+        float dist = std::hypot(prev.x - position.x, prev.y - position.y);
+        if (dist < best_dist) {
+            best_dist = dist;
+            nearest = &prev;
+        }
+    }
+    // A ball that did not move or a new ball does not need any interpolation
+    if (nearest == nullptr || best_dist < 1.0f) return;
+
+    for (int k = 1; k < stride_; k++) {
+        float t = static_cast<float>(k) / static_cast<float>(stride_);
+        float x = nearest->x + t * (position.x - nearest->x);
+        float y = nearest->y + t * (position.y - nearest->y);
+        points_.push_back(cv::Point2f(static_cast<int>(x), static_cast<int>(y)));
+    }
+}
+
+
 
 // Function to draw holes on the table
 cv::Mat BallDetection::draw_holes(const cv::Mat& input_img) {
@@ -219,70 +352,146 @@ cv::Mat BallDetection::draw_holes(const cv::Mat& input_img) {
 }
 
 
-bool BallDetection::centerRefinement(cv::Mat img){
+bool BallDetection::centerRefinement(FrameContext& context){
+
+    // Grayscale plane of the whole frame, shared by all the balls
+    const cv::Mat& gray_frame = context.gray();
+    cv::Rect frame_rect(0, 0, gray_frame.cols, gray_frame.rows);
+    int min_dist = gray_frame.rows / config_.min_dist_divisor;
 
+    int radius1 = config_.refine_window;
+    cv::Mat mask1, gray, red;
     // access to friend class
-    for (auto & i : centers_) {
+    for (size_t b = 0; b < centers_.size(); b++) {
+        const cv::Point2f& i = centers_[b];
+        LogScope scope(Logger::frame(), static_cast<int>(b));
+
+        // A ball at rest keeps the result of its last refinement
+        if (ball_cache_enabled_ && ball_cache_.reuse(i, gray_frame, balls_)) continue;
+        int first = balls_.size();
 
         float cX = i.x;
         float cY = i.y;
 
-        int radius1 = 30;
-        cv::Mat mask1 = cv::Mat::zeros(img.size(), CV_8UC1);
-        cv::circle(mask1, cv::Point2f(cX, cY), radius1, cv::Scalar(255), -1);
-
-        cv::Mat circle_mask;
-        cv::bitwise_and(img, img, circle_mask, mask1);
+        // Crop around the ball, with a margin of zeros around the circle so that the edges
+        // are the same as on the whole masked frame
+        int margin = radius1 + 4;
+        cv::Rect box = cv::Rect(cvFloor(cX) - margin, cvFloor(cY) - margin, 2 * margin + 1, 2 * margin + 1) & frame_rect;
+        if (box.empty()) continue;
+        cv::Point2f offset(static_cast<float>(box.x), static_cast<float>(box.y));
 
+        mask1.create(box.size(), CV_8UC1);
+        mask1.setTo(cv::Scalar(0));
+        cv::circle(mask1, cv::Point2f(cX, cY) - offset, radius1, cv::Scalar(255), -1);
 
-        // split the channels
-        std::vector<cv::Mat> channels;
-        cv::split(circle_mask, channels);
-
-        // only use the red
-        cv::Mat red = channels[2];
-
-        cv::Mat gray;
-        cv::cvtColor(circle_mask, gray, cv::COLOR_BGR2GRAY);
+        // only use the gray and the red inside the circle
+        gray.create(box.size(), CV_8UC1);
+        gray.setTo(cv::Scalar(0));
+        gray_frame(box).copyTo(gray, mask1);
 
         // Apply Hough Circle Transform
         std::vector<cv::Vec3f> circles;
-        cv::HoughCircles(gray, circles, cv::HOUGH_GRADIENT, 1, gray.rows / 16, 107, 10, 5, 15);
+        float confidence = 1.0f;
+        cv::HoughCircles(gray, circles, cv::HOUGH_GRADIENT, 1, min_dist, config_.refine_canny, config_.refine_votes,
+                         config_.refine_min_radius, config_.refine_max_radius);
         if (circles.empty()) {
-            cv::HoughCircles(red, circles, cv::HOUGH_GRADIENT, 1, gray.rows / 16, 107, 10, 5, 15);
+            red.create(box.size(), CV_8UC1);
+            red.setTo(cv::Scalar(0));
+            context.red()(box).copyTo(red, mask1);
+            cv::HoughCircles(red, circles, cv::HOUGH_GRADIENT, 1, min_dist, config_.refine_canny, config_.refine_votes,
+                             config_.refine_min_radius, config_.refine_max_radius);
+            confidence = 0.5f;
         }
 
+        // Skip the ball, the other balls can still be refined
         if (circles.empty()) {
-            std::cerr << "Error: No circles detected!" << std::endl;
-            return false;
+            SVA_WARN("Could not refine the ball at %.1f %.1f", cX, cY);
+            continue;
         }
 
-        // Create a black image to draw white circles
-        cv::Mat mask = cv::Mat::zeros(img.size(), CV_8UC1);
-        // Draw the circles
+        // Add the circles, in the coordinates of the frame
         for (auto c : circles) {
-            cv::Point2f center = cv::Point2f(c[0], c[1]);
+            cv::Point2f center = cv::Point2f(c[0], c[1]) + offset;
             float radius = c[2];
-            if (radius < 6.5) radius = 7.1;
-            // Draw and fill the circle
-            cv::circle(mask, center, radius, cv::Scalar(255), -1, cv::LINE_AA);
-            radius_.push_back(radius + 2);
-            centers_ref_.push_back(center);
+            if (radius < config_.small_radius) radius = static_cast<float>(config_.min_radius);
+            if (balls_.push(center.x, center.y, radius + static_cast<float>(config_.radius_padding), confidence) < 0) {
+                SVA_WARN("More than %d balls detected", static_cast<int>(BallFrameState::kCapacity));
+                return true;
+            }
 
         }
+        if (ball_cache_enabled_) ball_cache_.store(i, gray_frame, balls_, first);
+    }
+
+    if (balls_.empty()) {
+        SVA_ERROR("No circles detected!");
+        return false;
     }
 
     return true;
 }
 
 
+// Function to classify the balls from the L2 norm of their mean color
+void BallDetection::classifyBalls(const cv::Mat& img) {
+    if (balls_.empty()) return;
+
+    // Calculate the mean color and L2 norm for each ball, on its bounding box only;
+    // the balls reused from the cache already have their norm
+    double l2_norms[BallFrameState::kCapacity];
+    cv::Rect frame_rect(0, 0, img.cols, img.rows);
+    for (int i = 0; i < balls_.size(); ++i) {
+        if (balls_.norm[i] >= 0) {
+            l2_norms[i] = balls_.norm[i];
+            continue;
+        }
+        float r = balls_.radius[i];
+        cv::Rect box(cvFloor(balls_.x[i] - r) - 1, cvFloor(balls_.y[i] - r) - 1, cvFloor(2 * r) + 4, cvFloor(2 * r) + 4);
+        box &= frame_rect;
+        if (box.empty()) {
+            l2_norms[i] = 0;
+            continue;
+        }
+
+        cv::Mat mask = cv::Mat::zeros(box.size(), CV_8UC1);
+        cv::circle(mask, cv::Point2f(balls_.x[i] - box.x, balls_.y[i] - box.y), balls_.radius[i], cv::Scalar(255), -1);
+
+        cv::Scalar meanColor = cv::mean(img(box), mask);
+
+        // Calculate L2 norm of the mean color
+        l2_norms[i] = cv::norm(meanColor);
+        balls_.norm[i] = static_cast<float>(l2_norms[i]);
+    }
+
+    // Find the min and max L2 norm values
+    auto minmax = std::minmax_element(l2_norms, l2_norms + balls_.size());
+    double min_val = *minmax.first;
+    double max_val = *minmax.second;
+
+    for (int i = 0; i < balls_.size(); ++i) {
+        if (l2_norms[i] == max_val) {
+            balls_.label[i] = LABEL_WHITE; // White ball for max L2 norm
+        } else if (l2_norms[i] == min_val) {
+            balls_.label[i] = LABEL_BLACK; // Black ball for min L2 norm
+        } else if (l2_norms[i] < max_val && l2_norms[i] > config_.striped_norm) {
+            balls_.label[i] = LABEL_STRIPED; // Striped ball for L2 norm > 200
+        } else if (l2_norms[i] < config_.striped_norm && l2_norms[i] > min_val) {
+            balls_.label[i] = LABEL_SOLID; // Solid ball for L2 norm <= 200
+        } else {
+            balls_.label[i] = LABEL_UNKNOWN;
+        }
+    }
+}
+
+
 // Function to segment the image and produce outputs
-bool BallDetection::outputGenerator(const std::vector<cv::Point2f>& ballPositions, const cv::Mat& img, int radius, const cv::Mat& mask_table, const cv::Mat& bb_table, const std::string& filename) {
-    if (ballPositions.empty()) {
-        std::cerr << "Error: No ball positions detected!" << std::endl;
+bool BallDetection::outputGenerator(const cv::Mat& img, int radius, const cv::Mat& mask_table, const cv::Mat& bb_table, const std::string& filename) {
+    if (balls_.empty()) {
+        SVA_ERROR("No ball positions detected!");
         return false;
     }
     cv::Mat rec_table = img.clone();
+    std::vector<cv::Point2f> centers;
     std::vector<int> labels;
     std::vector<cv::Rect> boundingBoxes;
 
@@ -292,73 +501,45 @@ bool BallDetection::outputGenerator(const std::vector<cv::Point2f>& ballPosition
     cv::Scalar solidColor(3, 3, 3);
     cv::Scalar stripedColor(4, 4, 4);
 
-    // Calculate the mean color and L2 norm for each position
-    std::vector<double> l2_norms(ballPositions.size(), 0.0);
-    for (size_t i = 0; i < ballPositions.size(); ++i) {
-
-        float cX = ballPositions[i].x;
-        float cY = ballPositions[i].y;
-
-
-        cv::Mat mask = cv::Mat::zeros(img.size(), CV_8UC1);
-        cv::circle(mask, cv::Point2f(cX, cY), radius_[i], cv::Scalar(255), -1);
-
-
-        cv::Scalar meanColor = cv::mean(img, mask);
-
-        // Calculate L2 norm of the mean color
-        double l2_norm = cv::norm(meanColor);
-        l2_norms[i] = l2_norm;
-
-    }
-
-    // Find the min and max L2 norm values
-    auto minmax = std::minmax_element(l2_norms.begin(), l2_norms.end());
-    double min_val = *minmax.first;
-    double max_val = *minmax.second;
+    // Draw the balls with the colors of their labels
+    for (int i = 0; i < balls_.size(); ++i) {
 
-    // Draw the balls with assigned colors based on L2 norms
-    for (size_t i = 0; i < ballPositions.size(); ++i) {
-
-        float cX = centers_ref_[i].x;
-        float cY = centers_ref_[i].y;
+        float cX = balls_.x[i];
+        float cY = balls_.y[i];
+        float r = balls_.radius[i];
 
 
         cv::Scalar color_mask, color_bb;
-        int label;
 
-        if (l2_norms[i] == max_val) {
+        if (balls_.label[i] == LABEL_WHITE) {
             color_mask = whiteColor; // White ball for max L2 norm
             color_bb = cv::Scalar(255, 255, 255); // White border for max L2 norm
-            label = 1;
-        } else if (l2_norms[i] == min_val) {
+        } else if (balls_.label[i] == LABEL_BLACK) {
             color_mask = blackColor; // Black ball for min L2 norm
             color_bb = cv::Scalar(0, 0, 0); // Black border for min L2 norm
-            label = 2;
-        } else if (l2_norms[i] < max_val && l2_norms[i] > 200) {
+        } else if (balls_.label[i] == LABEL_STRIPED) {
             color_mask = stripedColor; // Striped ball for L2 norm > 200
             color_bb = cv::Scalar(255, 0, 0); //Blue border for L2 norm > 200
-            label = 4;
-        } else if (l2_norms[i] < 200 && l2_norms[i] > min_val) {
+        } else if (balls_.label[i] == LABEL_SOLID) {
             color_mask = solidColor; // Solid ball for L2 norm <= 200
             color_bb = cv::Scalar(0, 0, 255); // Red border for L2 norm <= 200
-            label = 3;
         } else {
             continue;
         }
 
         // Draw the ball on the segmentation mask
-        cv::circle(mask_table, cv::Point2f(cX, cY), radius_[i], color_mask, -1);
+        cv::circle(mask_table, cv::Point2f(cX, cY), r, color_mask, -1);
         // Draw the ball on the bounding box mask
-        cv::circle(bb_table, cv::Point2f(cX, cY), radius_[i], color_bb, -1);
+        cv::circle(bb_table, cv::Point2f(cX, cY), r, color_bb, -1);
 
-        cv::Rect2f rect(cX - radius_[i], cY - radius_[i], 2.0 * radius_[i], 2.0 * radius_[i]);
+        cv::Rect2f rect(cX - r, cY - r, 2.0 * r, 2.0 * r);
 
         // Draw the rectangle on the output image
         cv::rectangle(rec_table, rect, color_bb, 2);
 
 
-        labels.push_back(label);
+        centers.push_back(balls_.center(i));
+        labels.push_back(balls_.label[i]);
         boundingBoxes.push_back(rect);
 
     }
@@ -374,7 +555,7 @@ bool BallDetection::outputGenerator(const std::vector<cv::Point2f>& ballPosition
     cv::imwrite(bb_table_name, bb_table);
 
 
-    saveDetections(bb_output_name, ballPositions, labels, boundingBoxes);
+    saveDetections(bb_output_name, centers, labels, boundingBoxes);
 
 
     return true;
@@ -384,7 +565,7 @@ bool BallDetection::outputGenerator(const std::vector<cv::Point2f>& ballPosition
 void BallDetection::saveDetections(const std::string& filename, const std::vector<cv::Point2f>& centers, const std::vector<int>& labels, const std::vector<cv::Rect>& boundingBoxes) {
     std::ofstream file(filename);
     if (!file.is_open()) {
-        std::cerr << "Failed to to save outputs" << std::endl;
+        SVA_ERROR("Failed to save outputs %s", filename.c_str());
         return;
     }
 
@@ -414,34 +595,37 @@ void BallDetection::saveDetections(const std::string& filename, const std::vecto
 }
 
 
-bool BallDetection::createTopViewMinimap(const std::vector<cv::Point2f>& ballPositions, const cv::Mat& img, const std::vector<cv::Point2f>& tableCorners) {
-    cv::Mat output = cv::Mat::zeros(img.size(), CV_8UC1); // Create a black image
-
+// Function to calculate the perspective transformation matrix from the frame to the minimap
+cv::Mat BallDetection::computeHomography(const std::vector<cv::Point2f>& tableCorners) const {
     std::vector<cv::Point2f> pts2;
     pts2.emplace_back(0, 0);                                      // top left
     pts2.emplace_back(static_cast<float>(width_ - 1), 0);         // top right
     pts2.emplace_back(0, static_cast<float>(height_ - 1));        // bottom left
     pts2.emplace_back(static_cast<float>(width_ - 1), height_ - 1); // bottom right
 
-    // Calculate the perspective transformation matrix
-    cv::Mat transformMatrix = cv::getPerspectiveTransform(tableCorners, pts2);
+    return cv::getPerspectiveTransform(tableCorners, pts2);
+}
+
+
+bool BallDetection::createTopViewMinimap(const std::vector<cv::Point2f>& tableCorners) {
+    // The camera does not move, the perspective transformation matrix is calculated only once
+    if (homography_.empty()) homography_ = computeHomography(tableCorners);
+    const cv::Mat& transformMatrix = homography_;
 
     // Transform ball positions to the minimap
-    std::vector<cv::Point2f> minimapBallPositions;
-    for (const auto& pos : ballPositions) {
-        minimapBallPositions.push_back(transformPoint(pos, transformMatrix));
+    for (int i = 0; i < balls_.size(); ++i) {
+        cv::Point2f position = transformPoint(balls_.center(i), transformMatrix);
+        balls_.map_x[i] = position.x;
+        balls_.map_y[i] = position.y;
     }
-    // Warp the image to the minimap
-    cv::Mat minimap;
-    cv::warpPerspective(img, minimap, transformMatrix, cv::Size(width_, height_));
     // Create the table
     cv::Mat background = create_table(width_, height_);
-    // Draw the balls on the minimap
-    cv::Mat final = draw_balls(minimapBallPositions, background, 12, -1, minimap);
+    // Draw the balls on the minimap, with the labels of the balls in the frame
+    cv::Mat final = draw_balls(background, ball_radius_, -1);
     // Draw the holes on the table
     top_view_ = draw_holes(final);
     if (top_view_.empty()) {
-        std::cerr << "Error: Could not create the minimap" << std::endl;
+        SVA_ERROR("Could not create the minimap");
         return false;
     }
 
@@ -487,13 +671,223 @@ std::vector<cv::Point2f> sortCorners(const std::vector<cv::Point2f>& corners) {
     return {topLeft, topRight, bottomRight, bottomLeft};
 }
 
+// Function to compose the output frame with the minimap in a corner, bottom left by default
+cv::Mat BallDetection::composeOutput(const cv::Mat& frame, const cv::Size& final_size) {
+    int N = 10;
+    cv::Mat frame_border;
+    cv::copyMakeBorder(frame, frame_border, N, N, 0, 0, cv::BORDER_CONSTANT);
+
+    // No minimap before the first analysed frame
+    if (top_view_.empty()) {
+        cv::Mat final;
+        cv::resize(frame_border, final, final_size, 0, 0, cv::INTER_AREA);
+        return final;
+    }
+
+    // Resize the minimap according to the frame size
+    cv::Size mini_map_size(static_cast<int>(frame_border.rows * 0.25), static_cast<int>(frame_border.cols * 0.25));
+    cv::Mat resized_top_view;
+    cv::resize(top_view_, resized_top_view, mini_map_size);
+    cv::rotate(resized_top_view, resized_top_view, cv::ROTATE_90_CLOCKWISE);
+    cv::copyMakeBorder(resized_top_view, resized_top_view, 10, 10, 10, 10, cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255));
+
+    bool right = overlay_ == "top-right" || overlay_ == "bottom-right";
+    bool top = overlay_ == "top-left" || overlay_ == "top-right";
+    int offset_x = right ? frame_border.cols - resized_top_view.cols - 10 : 10;
+    int offset_y = top ? 10 : frame_border.rows - resized_top_view.rows - 10;
+
+    // Create final output
+    cv::Mat final = frame_border.clone();
+    resized_top_view.copyTo(final(cv::Rect(offset_x, offset_y, resized_top_view.cols, resized_top_view.rows)));
+
+    cv::resize(final,final,  final_size, 0, 0, cv::INTER_AREA);
+    return final;
+}
+
+// Function to detect, refine and classify the balls of a frame
+bool BallDetection::detectBalls(const cv::Mat& frame, const TableSpans& table) {
+    centers_.clear();
+    balls_.clear();
+    if (ball_cache_enabled_) ball_cache_.beginFrame();
+
+    // The derived planes of the frame are computed once and shared by the stages,
+    // the table objects are only processed inside the table
+    context_.reset(frame, table, config_);
+
+    // Process the table objects
+    if (!processTableObjects(context_)) {
+        SVA_ERROR("Could not detect table objects");
+        return false;
+    }
+    if (!centerRefinement(context_)){
+        SVA_ERROR("Could not refine the circles");
+        return false;
+    }
+    // Classify the balls once for all the outputs
+    classifyBalls(frame);
+    if (ball_cache_enabled_) ball_cache_.commit(balls_);
+    return true;
+}
+
+// Function to analyse a frame: detect and refine the balls and update the minimap
+bool BallDetection::analyzeFrame(const cv::Mat& frame, const TableSpans& table, const std::vector<cv::Point2f>& tableCorners) {
+    if (!detectBalls(frame, table)) return false;
+    // Create the minimap
+    if (!createTopViewMinimap(tableCorners)) {
+        SVA_ERROR("Could not create the minimap");
+        return false;
+    }
+    return true;
+}
+
+// Function to save the progress of process_video, written to a temporary file first so that
+// a job killed while saving keeps the previous checkpoint
+bool BallDetection::saveCheckpoint(const std::string& filename, const Checkpoint& state, const ProcessOptions& options,
+                                   const TableCalibration& calibration, const EventDetection& events) const {
+    std::string tmp = filename + ".tmp";
+    {
+        cv::FileStorage fs(tmp, cv::FileStorage::WRITE);
+        if (!fs.isOpened()) {
+            SVA_ERROR("Failed to save the checkpoint %s", filename.c_str());
+            return false;
+        }
+        fs << "start" << options.start;
+        fs << "stride" << stride_;
+        fs << "next_frame" << state.next_frame;
+        fs << "frame_num" << state.frame_num;
+        fs << "segment" << state.segment;
+        fs << "failed" << state.failed;
+        fs << "first_saved" << (state.first_saved ? 1 : 0);
+        calibration.write(fs);
+        fs << "trajectory" << points_;
+        fs << "prev_minimap" << prev_minimap_;
+        events.write(fs);
+        fs.release();
+    }
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+        SVA_ERROR("Failed to save the checkpoint %s", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Function to restore the progress of process_video from a checkpoint
+bool BallDetection::loadCheckpoint(const std::string& filename, Checkpoint& state, const ProcessOptions& options,
+                                   TableCalibration& calibration, EventDetection& events) {
+    cv::FileStorage fs(filename, cv::FileStorage::READ);
+    if (!fs.isOpened()) return false;
+
+    int start = 0, stride = 0, first_saved = 0;
+    fs["start"] >> start;
+    fs["stride"] >> stride;
+    if (start != options.start || stride != stride_) {
+        SVA_ERROR("The checkpoint was saved with a different frame range or stride");
+        return false;
+    }
+    fs["next_frame"] >> state.next_frame;
+    fs["frame_num"] >> state.frame_num;
+    fs["segment"] >> state.segment;
+    fs["failed"] >> state.failed;
+    fs["first_saved"] >> first_saved;
+    state.first_saved = first_saved != 0;
+    calibration.read(fs);
+    fs["trajectory"] >> points_;
+    fs["prev_minimap"] >> prev_minimap_;
+    bool events_read = events.read(fs);
+    fs.release();
+
+    if (!events_read) {
+        SVA_ERROR("The events of the checkpoint were saved in another format");
+        return false;
+    }
+
+    if (!calibration.isCurrent()) {
+        SVA_ERROR("The checkpoint was saved with another version of the calibration");
+        return false;
+    }
+    return calibration.corners.size() == 4 && calibration.sorted_corners.size() == 4;
+}
+
+// Function to build the background model from frames sampled evenly between first and last,
+// the capture is moved back to the first frame
+bool BallDetection::buildBackground(const TableSpans& spans, int first, int last) {
+    const int samples = 15;
+    // Without the number of frames, sample the next seconds of the stream
+    if (last == std::numeric_limits<int>::max()) last = first + samples * 30;
+
+    std::vector<cv::Mat> frames;
+    cv::Mat frame;
+    for (int i = 0; i < samples; i++) {
+        int pos = first + static_cast<int>(static_cast<long long>(last - first) * i / (samples - 1));
+        capture_.set(cv::CAP_PROP_POS_FRAMES, pos);
+        if (capture_.read(frame)) frames.push_back(frame.clone());
+    }
+    capture_.set(cv::CAP_PROP_POS_FRAMES, first);
+
+    double t_build = static_cast<double>(cv::getTickCount());
+    // Balls of each sample with the KMeans segmentation, left out of the median: the objects of the
+    // mask and a disc of the largest refined radius around each center
+    std::vector<cv::Mat> masks;
+    FrameContext context;
+    int radius = cvCeil(config_.refine_max_radius + config_.radius_padding);
+    cv::Mat grow = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(5, 5));
+    for (const auto& sample : frames) {
+        context.reset(sample, spans, config_);
+        cv::Mat objects = tableObjectMask(context);
+        cv::Mat mask = cv::Mat::zeros(sample.size(), CV_8UC1);
+        cv::dilate(objects, mask(context.roi()), grow);
+        for (const auto& center : maskCenters(context, objects)) {
+            cv::circle(mask, center, radius, cv::Scalar(255), -1);
+        }
+        masks.push_back(mask);
+    }
+    // The masks of the samples are not part of the statistics of the analysed frames
+    contour_ticks_ = 0;
+    reference_ticks_ = 0;
+    mask_mismatches_ = 0;
+
+    if (!background_.build(frames, masks, spans)) return false;
+    SVA_INFO("Built the background model from %d frames in %.2f s", static_cast<int>(frames.size()),
+             (static_cast<double>(cv::getTickCount()) - t_build) / cv::getTickFrequency());
+    return true;
+}
+
+// Function to write the list of the output segments for the ffmpeg concat demuxer
+void writeSegmentList(const std::string& output_path, int segments) {
+    std::ofstream file(outputName(output_path, "_segments.txt"));
+    for (int i = 0; i < segments; i++) {
+        std::string name = segmentName(output_path, i);
+        size_t slash = name.find_last_of("/\\");
+        file << "file '" << (slash == std::string::npos ? name : name.substr(slash + 1)) << "'" << std::endl;
+    }
+}
+
 // Function to process the video
-bool BallDetection::process_video(const std::string& input_path,const std::string& output_path) {
-    std::cout << "Processing video..." << std::endl;
+bool BallDetection::process_video(const std::string& input_path,const std::string& output_path, const ProcessOptions& options) {
+    // Replay a previous analysis
+    if (!options.render_from.empty()) return render_video(input_path, output_path, options);
+
+    SVA_INFO("Processing video %s", input_path.c_str());
+    setRenderOptions(options);
+    verify_mask_ = options.verify_mask;
+    contour_ticks_ = 0;
+    reference_ticks_ = 0;
+    mask_mismatches_ = 0;
+    verify_background_ = options.verify_background;
+    ball_cache_enabled_ = options.ball_cache;
+    ball_cache_.clear();
+    use_background_ = options.background || verify_background_;
+    background_.clear();
+    background_ticks_ = 0;
+    mask_ticks_ = 0;
+    iou_sum_ = 0;
+    verified_frames_ = 0;
+    centers_matched_ = 0;
+    centers_expected_ = 0;
 
     capture_.open(input_path);
     if (!capture_.isOpened()) {
-        std::cerr << "Error opening video stream or file" << std::endl;
+        SVA_ERROR("Could not open the video stream or file %s", input_path.c_str());
         return false;
     }
 
@@ -501,23 +895,73 @@ bool BallDetection::process_video(const std::string& input_path,const std::strin
     int H = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT));
     cv::Size final_size(W, H);
 
-    int N = 10;
-    int frame_num = 0;
-
     int total_frames = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_COUNT));
     int FPS = static_cast<int>(capture_.get(cv::CAP_PROP_FPS));
-    int fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
-    cv::VideoWriter out(output_path, fourcc, FPS, final_size);
+
+    // Range of frames to process, the first one is only used to detect the table
+    int last_frame = total_frames > 0 ? total_frames - 1 : std::numeric_limits<int>::max();
+    if (options.end >= 0 && options.end < last_frame) last_frame = options.end;
+    if (options.start < 0 || options.start >= last_frame) {
+        SVA_ERROR("Invalid frame range");
+        return false;
+    }
+    stride_ = std::max(1, options.stride);
+    int first_analysed = options.start + 1;
+
+    // Seek straight to the first frame of the range
+    if (options.start > 0) capture_.set(cv::CAP_PROP_POS_FRAMES, options.start);
 
     cv::Mat firstFrame, frame;
     // Read the first frame to detect the table corners
     capture_ >> firstFrame;
+    if (firstFrame.empty()) {
+        SVA_ERROR("Could not read the first frame");
+        return false;
+    }
     TableDetection vp(this);
-    if (!vp.detectTableCorners(firstFrame)) {
-        std::cerr << "Error: Could not detect table corners" << std::endl;
+    homography_.release();
+    cloth_centers_.release();
+    warm_start_ = false;
+    points_.clear();
+    prev_minimap_.clear();
+    top_view_.release();
+
+    // Detect the shots and the events of the balls on the minimap
+    EventDetection events(width_, height_);
+
+    // The files saved next to the output are named after the input when the output is stdout
+    const std::string& side_path = output_path == "-" ? input_path : output_path;
+    // Restore the progress of a previous run
+    std::string checkpoint_path = outputName(side_path, "_checkpoint.yml");
+    Checkpoint state;
+    state.next_frame = first_analysed;
+    TableCalibration calibration;
+    bool resumed = options.resume && loadCheckpoint(checkpoint_path, state, options, calibration, events);
+    if (options.resume && !resumed) {
+        SVA_INFO("No valid checkpoint, starting from frame %d", first_analysed);
+        state = Checkpoint();
+        state.next_frame = first_analysed;
+        events = EventDetection(width_, height_);
+        points_.clear();
+        prev_minimap_.clear();
+    }
+
+    // Load the calibration of the camera to skip the table detection
+    bool calibrated = resumed || (!options.calibration.empty() && calibration.load(options.calibration) &&
+                                  calibration.matches(firstFrame));
+    if (calibrated) {
+        SVA_INFO("Using the calibration %s", (resumed ? checkpoint_path : options.calibration).c_str());
+        vp.tableCorners_ = calibration.corners;
+        cloth_centers_ = calibration.cloth_centers;
+        // Only a run with a calibration starts KMeans from the stored cloth colour model
+        warm_start_ = !options.calibration.empty();
+    } else if (!vp.detectTableCorners(firstFrame)) {
+        SVA_ERROR("Could not detect table corners");
         return false;
     }
-    std::vector<cv::Point2f> sortedCorners = sortCorners(vp.tableCorners_);
+    std::vector<cv::Point2f> sortedCorners = calibrated ? calibration.sorted_corners : sortCorners(vp.tableCorners_);
+    // The perspective transformation depends on the size of the minimap
+    homography_ = computeHomography(vp.tableCorners_);
 
     cv::Rect boundingRect = cv::boundingRect(sortedCorners);
 
@@ -533,75 +977,400 @@ bool BallDetection::process_video(const std::string& input_path,const std::strin
     }
     cv::fillConvexPoly(black, corners, fieldColor);
     cv::fillConvexPoly(green, corners, cv::Scalar(0, 255, 0));
+    // Runs of table pixels of each row, shared by all the frames
+    TableSpans table_spans;
+    table_spans.build(black, boundingRect);
+
+    // Model of the empty table from frames sampled over the range
+    if (use_background_ && !buildBackground(table_spans, first_analysed, last_frame)) {
+        SVA_WARN("Could not build the background model, using the KMeans segmentation");
+        use_background_ = false;
+        verify_background_ = false;
+    }
 
-    while (capture_.read(frame)) {
+    // Save the calibration of a new camera, with the cloth colour model learned on the first frame.
+    // It is only needed for the calibration file and for the checkpoints
+    if (!calibrated && (!options.calibration.empty() || options.checkpoint > 0)) {
+        FrameContext first_context;
+        first_context.reset(firstFrame, table_spans, config_);
+        vp.KMeans(first_context);
+
+        calibration.frame_size = firstFrame.size();
+        calibration.fingerprint = TableCalibration::computeFingerprint(firstFrame);
+        calibration.corners = vp.tableCorners_;
+        calibration.sorted_corners = sortedCorners;
+        calibration.homography = homography_;
+        calibration.cloth_centers = cloth_centers_;
+        if (!options.calibration.empty() && calibration.save(options.calibration)) {
+            SVA_INFO("Saved the calibration %s", options.calibration.c_str());
+        }
+    }
 
-        cv::Mat frame_border;
-        cv::copyMakeBorder(frame, frame_border, N, N, 0, 0, cv::BORDER_CONSTANT);
-        // Create a mask for the table to only process the table objects inside the table
-        cv::Mat mask_table;
-        cv::bitwise_and(frame, frame, mask_table, black);
+    // With checkpoints the output is split in segments that are closed at every checkpoint,
+    // so that a killed job only loses the segment being written
+    bool to_stdout = output_path == "-";
+    bool segmented = options.checkpoint > 0 && !to_stdout && options.sink != "images";
+    auto segmentPath = [&](int segment) { return segmented ? segmentName(output_path, segment) : output_path; };
+
+    // Keep the duration of the output video when frames are skipped
+    double out_fps = std::max(1.0, static_cast<double>(FPS) / stride_);
+    // No output is written in analysis-only mode
+    std::unique_ptr<OutputSink> out;
+    if (!options.analysis_only) {
+        out = createSink(options.sink, options.codec, options.compression);
+        if (!out) return false;
+        if (!out->open(segmentPath(state.segment), out_fps, final_size)) return false;
+    }
 
-        // Process the table objects
-        if (!processTableObjects(mask_table, boundingRect)) {
-            std::cerr << "Error: Could not detect table objects" << std::endl;
-            return false;
+    // Live ball positions for the local consumers
+    BallStatePublisher publisher;
+    if (!options.shm.empty()) {
+        if (!publisher.open(options.shm, width_, height_)) return false;
+        SVA_INFO("Publishing the balls in the shared memory %s", options.shm.c_str());
+    }
+
+    // Save the balls of every analysed frame to render the output again
+    AnalysisCacheWriter cache;
+    if (!options.save_analysis.empty()) {
+        AnalysisInfo info;
+        info.frame_size = firstFrame.size();
+        info.start = options.start;
+        info.stride = stride_;
+        info.map_size = cv::Size(width_, height_);
+        info.fps = FPS;
+        info.corners = vp.tableCorners_;
+        info.sorted_corners = sortedCorners;
+        info.homography = homography_;
+        if (!cache.open(options.save_analysis, info, resumed)) return false;
+    }
+
+    // Continue from the frame of the checkpoint
+    if (resumed) {
+        SVA_INFO("Resuming from frame %d", state.next_frame);
+        capture_.set(cv::CAP_PROP_POS_FRAMES, state.next_frame);
+    }
+
+    // Time spent in the analysis, in the compositing and in the encoding of the output
+    double analysis_ticks = 0, output_ticks = 0, encode_ticks = 0;
+    int analysed_since_checkpoint = 0;
+
+    // Last frame analysed successfully and its balls, for the outputs of the last frame
+    cv::Mat last_analysed;
+    BallFrameState last_balls;
+    bool read_failed = false;
+
+    // Index of the next frame in the video
+    int pos = state.next_frame;
+    while (pos <= last_frame) {
+
+        // Frames between two analysed frames are grabbed without being decoded
+        if ((pos - first_analysed) % stride_ != 0) {
+            if (!capture_.grab()) {
+                read_failed = true;
+                break;
+            }
+            pos++;
+            continue;
         }
-        if (!centerRefinement(frame)){
-            std::cerr << "Error: Could not refine the circles" << std::endl;
-            return false;
+        if (!capture_.read(frame)) {
+            read_failed = true;
+            break;
         }
-        // Create the minimap
-        if (!createTopViewMinimap(centers_ref_, frame, vp.tableCorners_)) {
-            std::cerr << "Error: Could not create the minimap" << std::endl;
-            return false;
+        LogScope scope(pos);
+
+        double t_analysis = static_cast<double>(cv::getTickCount());
+        // A frame that cannot be analysed keeps the minimap of the previous frame
+        bool analysed = analyzeFrame(frame, table_spans, vp.tableCorners_);
+        if (analysed) {
+            balls_.frame = pos;
+            events.update(pos, balls_);
+            publisher.publish(balls_);
+            if (!options.save_analysis.empty() && !cache.write(balls_)) {
+                SVA_ERROR("Could not write the analysis cache %s", options.save_analysis.c_str());
+                return false;
+            }
+        } else {
+            SVA_WARN("Skipping frame %d", pos);
+            state.failed++;
         }
 
-        // Generate outputs only on first frame and last frame
-        if (frame_num == 0){
+        // Generate outputs on the first frame, those of the last frame are written after the loop
+        if (analysed && !state.first_saved){
 //            cv::imwrite("first_frame.png", frame);
-            if (!outputGenerator(centers_ref_, frame, 10, black, green, "first")) {
-                std::cerr << "Error: Could not segment the image" << std::endl;
+            if (!outputGenerator(frame, 10, black.clone(), green.clone(), "first")) {
+                SVA_ERROR("Could not segment the image");
+            }
+            state.first_saved = true;
+        }
+        double t_output = static_cast<double>(cv::getTickCount());
+        analysis_ticks += t_output - t_analysis;
+
+        if (!options.analysis_only) {
+            cv::Mat final = composeOutput(frame, final_size);
+            double t_encode = static_cast<double>(cv::getTickCount());
+            output_ticks += t_encode - t_output;
+            if (!out->write(final, pos)) {
+                SVA_ERROR("Could not write the output frame");
                 return false;
             }
-
-        } else if (frame_num == total_frames - 2){
-            cv::imwrite("final_2d.png", top_view_);
-            if (!outputGenerator(centers_ref_, frame, 10, black, green, "last")) {
-                std::cerr << "Error: Could not segment the image" << std::endl;
+            encode_ticks += static_cast<double>(cv::getTickCount()) - t_encode;
+            if (options.preview) cv::imshow("Output", final);
+        }
+        // Keep the frame without copying it, the next frame is decoded in the buffer of the previous one
+        if (analysed) {
+            cv::swap(frame, last_analysed);
+            last_balls = balls_;
+        }
+        state.frame_num++;
+        pos++;
+
+        // Close the output segment and save the progress
+        if (options.checkpoint > 0 && ++analysed_since_checkpoint >= options.checkpoint && pos <= last_frame) {
+            analysed_since_checkpoint = 0;
+            if (out && segmented) {
+                out->close();
+                state.segment++;
+                if (!out->open(segmentPath(state.segment), out_fps, final_size)) return false;
+                writeSegmentList(output_path, state.segment);
+            }
+            state.next_frame = pos;
+            calibration.cloth_centers = cloth_centers_;
+            if (!options.save_analysis.empty() && !cache.flush()) {
+                SVA_ERROR("Could not write the analysis cache %s", options.save_analysis.c_str());
                 return false;
             }
+            // Without a checkpoint a killed job could not be resumed, saveCheckpoint logs the error
+            if (!saveCheckpoint(checkpoint_path, state, options, calibration, events)) return false;
+        }
+
+        if (!options.analysis_only && options.preview && cv::waitKey(1) == 27) break;
+    }
+
+    // The whole range was processed, or the stream of unknown length ended; a frame that could not
+    // be read before the end of the range keeps the checkpoint for --resume
+    bool finished = pos > last_frame || (read_failed && last_frame == std::numeric_limits<int>::max());
+    if (read_failed && !finished) SVA_ERROR("Could not read frame %d of %s", pos, input_path.c_str());
+
+    // Outputs of the last frame analysed successfully, top_view_ still shows its balls
+    if (!last_analysed.empty()) {
+        balls_ = last_balls;
+        cv::imwrite("final_2d.png", top_view_);
+        if (!outputGenerator(last_analysed, 10, black.clone(), green.clone(), "last")) {
+            SVA_ERROR("Could not segment the image");
+        }
+    }
 
+    // Report the throughput of the analysis and of the output
+    double analysis_sec = analysis_ticks / cv::getTickFrequency();
+    double output_sec = output_ticks / cv::getTickFrequency();
+    double encode_sec = encode_ticks / cv::getTickFrequency();
+    SVA_INFO("Analysed %d frames, %d skipped", state.frame_num, state.failed);
+    int frame_num = state.frame_num;
+    if (frame_num > 0 && analysis_sec > 0) {
+        SVA_INFO("Analysis: %.2f s (%.2f fps)", analysis_sec, frame_num / analysis_sec);
+        if (!options.analysis_only) {
+            SVA_INFO("Compositing: %.2f s, encoding (%s): %.2f s, analysis with output: %.2f fps", output_sec,
+                     options.sink.c_str(), encode_sec, frame_num / (analysis_sec + output_sec + encode_sec));
         }
+    }
 
+    // Time of the ball masks and accuracy of the background model
+    if (frame_num > 0) {
+        double mask_ms = mask_ticks_ / cv::getTickFrequency() * 1000.0 / frame_num;
+        if (use_background_) {
+            double background_ms = background_ticks_ / cv::getTickFrequency() * 1000.0 / frame_num;
+            SVA_INFO("Background mask: %.2f ms per frame", background_ms);
+        }
+        if (verify_background_ && verified_frames_ > 0) {
+            SVA_INFO("KMeans mask: %.2f ms per frame, mean IoU with the background mask %.3f, %d of %d centers found",
+                     mask_ms, iou_sum_ / verified_frames_, centers_matched_, centers_expected_);
+        } else if (!use_background_) {
+            SVA_INFO("KMeans mask: %.2f ms per frame", mask_ms);
+        }
+    }
 
-        // Resize the minimap according to the frame size
-        cv::Size mini_map_size(static_cast<int>(frame_border.rows * 0.25), static_cast<int>(frame_border.cols * 0.25));
-        cv::Mat resized_top_view;
-        cv::resize(top_view_, resized_top_view, mini_map_size);
-        cv::rotate(resized_top_view, resized_top_view, cv::ROTATE_90_CLOCKWISE);
-        cv::copyMakeBorder(resized_top_view, resized_top_view, 10, 10, 10, 10, cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255));
+    if (ball_cache_enabled_) {
+        SVA_INFO("Ball cache: %d candidates reused, %d refined", ball_cache_.reused(), ball_cache_.refined());
+    }
 
-        int offset_x = 10;
-        int offset_y = frame_border.rows - resized_top_view.rows - 10;
+    // Time of the contour mask and differences with the untiled chain
+    if (frame_num > 0 && contour_ticks_ > 0) {
+        double contour_ms = contour_ticks_ / cv::getTickFrequency() * 1000.0 / frame_num;
+        if (verify_mask_) {
+            double reference_ms = reference_ticks_ / cv::getTickFrequency() * 1000.0 / frame_num;
+            SVA_INFO("Contour mask: %.2f ms per frame, reference %.2f ms per frame, %d frames differ", contour_ms,
+                     reference_ms, mask_mismatches_);
+        } else {
+            SVA_INFO("Contour mask: %.2f ms per frame", contour_ms);
+        }
+    }
+
+    if (!options.save_analysis.empty() && !cache.flush()) {
+        SVA_ERROR("Could not write the analysis cache %s", options.save_analysis.c_str());
+        return false;
+    }
+
+    // Save the index of the shots and events next to the output video
+    events.finish();
+    events.saveIndex(outputName(side_path, "_events.txt"));
+
+    capture_.release();
+    if (out) out->close();
+    if (segmented) writeSegmentList(output_path, state.segment + 1);
+    // The run is complete, a new run must not resume from the last checkpoint
+    if (options.checkpoint > 0 && finished) std::remove(checkpoint_path.c_str());
+    if (!options.analysis_only && options.preview) cv::destroyAllWindows();
+
+    // Stopped with ESC the run succeeded, a frame that could not be read is a failure
+    return finished || !read_failed;
+}
+
+
+// Function to apply the settings of the minimap and of the output
+void BallDetection::setRenderOptions(const ProcessOptions& options) {
+    if (options.map_size.width > 0 && options.map_size.height > 0) {
+        width_ = options.map_size.width;
+        height_ = options.map_size.height;
+    }
+    ball_radius_ = std::max(1, options.ball_radius);
+    draw_trail_ = options.trail;
+    overlay_ = options.overlay;
+}
+
+
+// Function to render the output video from an analysis cache: the frames are only decoded,
+// the balls of each frame are read from the cache instead of being detected
+bool BallDetection::render_video(const std::string& input_path,const std::string& output_path, const ProcessOptions& options) {
+    SVA_INFO("Rendering video %s from %s", input_path.c_str(), options.render_from.c_str());
+    setRenderOptions(options);
+
+    AnalysisCacheReader cache;
+    if (!cache.open(options.render_from)) return false;
+    const AnalysisInfo& info = cache.info();
+
+    capture_.open(input_path);
+    if (!capture_.isOpened()) {
+        SVA_ERROR("Could not open the video stream or file %s", input_path.c_str());
+        return false;
+    }
+    int W = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH));
+    int H = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT));
+    cv::Size final_size(W, H);
+    if (final_size != info.frame_size) {
+        SVA_ERROR("The analysis cache was saved for a video of a different size");
+        return false;
+    }
+    int total_frames = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_COUNT));
+    int FPS = static_cast<int>(capture_.get(cv::CAP_PROP_FPS));
 
-        // Create final output
-        cv::Mat final = frame_border.clone();
-        resized_top_view.copyTo(final(cv::Rect(offset_x, offset_y, resized_top_view.cols, resized_top_view.rows)));
+    // Same frames as the analysis, the end of the range can still be changed
+    if ((options.start != 0 && options.start != info.start) || (options.stride != 1 && options.stride != info.stride)) {
+        SVA_ERROR("The analysis cache was saved with --start %d --stride %d, the range cannot be changed",
+                  info.start, info.stride);
+        return false;
+    }
+    int last_frame = total_frames > 0 ? total_frames - 1 : std::numeric_limits<int>::max();
+    if (options.end >= 0 && options.end < last_frame) last_frame = options.end;
+    stride_ = std::max(1, info.stride);
+    int first_analysed = info.start + 1;
+    if (info.start > 0) capture_.set(cv::CAP_PROP_POS_FRAMES, info.start);
+
+    // The first frame of the range is the one of the table detection, used for the segmentation outputs
+    cv::Mat firstFrame;
+    capture_ >> firstFrame;
+    if (firstFrame.empty()) {
+        SVA_ERROR("Could not read the first frame");
+        return false;
+    }
+    cv::Mat black = cv::Mat::zeros(firstFrame.size(), CV_8UC1);
+    cv::Mat green = firstFrame.clone();
+    std::vector<cv::Point> corners;
+    for (const auto& pt : info.sorted_corners) {
+        corners.emplace_back(pt);
+    }
+    cv::fillConvexPoly(black, corners, cv::Scalar(5, 5, 5));
+    cv::fillConvexPoly(green, corners, cv::Scalar(0, 255, 0));
 
-        cv::resize(final,final,  final_size, 0, 0, cv::INTER_AREA);
-        cv::imshow("Output", final);
-        out.write(final);
-        centers_.clear();
-        centers_ref_.clear();
-        radius_.clear();
+    points_.clear();
+    prev_minimap_.clear();
+    top_view_.release();
+    // The cached transformation is only valid for a minimap of the same size
+    homography_ = info.map_size == cv::Size(width_, height_) ? info.homography.clone() : computeHomography(info.corners);
+
+    double out_fps = std::max(1.0, static_cast<double>(FPS) / stride_);
+    std::unique_ptr<OutputSink> out = createSink(options.sink, options.codec, options.compression);
+    if (!out) return false;
+    if (!out->open(output_path, out_fps, final_size)) return false;
+
+    double render_ticks = 0, encode_ticks = 0;
+    int frame_num = 0, missing = 0;
+    bool first_saved = false;
+    // Last frame with balls in the cache, for the outputs of the last frame
+    cv::Mat frame, last_analysed;
+    int pos = first_analysed;
+    while (pos <= last_frame) {
+
+        // Frames between two analysed frames are grabbed without being decoded
+        if ((pos - first_analysed) % stride_ != 0) {
+            if (!capture_.grab()) break;
+            pos++;
+            continue;
+        }
+        if (!capture_.read(frame)) break;
+        LogScope scope(pos);
+
+        double t_render = static_cast<double>(cv::getTickCount());
+        // A frame that was not analysed keeps the minimap of the previous frame
+        bool analysed = cache.read(pos, balls_);
+        if (analysed) {
+            createTopViewMinimap(info.corners);
+        } else {
+            missing++;
+        }
+        if (analysed && !first_saved) {
+            if (!outputGenerator(frame, 10, black.clone(), green.clone(), "first")) {
+                SVA_ERROR("Could not segment the image");
+            }
+            first_saved = true;
+        }
+        cv::Mat final = composeOutput(frame, final_size);
+        double t_encode = static_cast<double>(cv::getTickCount());
+        render_ticks += t_encode - t_render;
+        if (!out->write(final, pos)) {
+            SVA_ERROR("Could not write the output frame");
+            return false;
+        }
+        encode_ticks += static_cast<double>(cv::getTickCount()) - t_encode;
+        // Keep the frame without copying it, the next frame is decoded in the buffer of the previous one
+        if (analysed) cv::swap(frame, last_analysed);
         frame_num++;
-        if (cv::waitKey(1) == 27) break;
+        pos++;
+
+        if (options.preview) {
+            cv::imshow("Output", final);
+            if (cv::waitKey(1) == 27) break;
+        }
+    }
+
+    double render_sec = render_ticks / cv::getTickFrequency();
+    double encode_sec = encode_ticks / cv::getTickFrequency();
+    SVA_INFO("Rendered %d frames, %d without analysis", frame_num, missing);
+
+    // Outputs of the last frame with balls in the cache, balls_ still holds its balls
+    if (!last_analysed.empty()) {
+        cv::imwrite("final_2d.png", top_view_);
+        if (!outputGenerator(last_analysed, 10, black.clone(), green.clone(), "last")) {
+            SVA_ERROR("Could not segment the image");
+        }
+    }
+    if (frame_num > 0 && render_sec + encode_sec > 0) {
+        SVA_INFO("Compositing: %.2f s, encoding (%s): %.2f s, %.2f fps", render_sec, options.sink.c_str(), encode_sec,
+                 frame_num / (render_sec + encode_sec));
     }
 
     capture_.release();
-    out.release();
-    cv::destroyAllWindows();
+    out->close();
+    if (options.preview) cv::destroyAllWindows();
 
     return true;
 }
@@ -0,0 +1,264 @@
+/*
+ * File:    BallStateRing.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the shared-memory ring used to publish the
+ *             balls of every analysed frame to local processes. The producer writes each state once
+ *             into a POSIX shared-memory slot protected by a sequence number (seqlock), the readers
+ *             map the same memory read-only and validate the sequence number around their copy, so
+ *             a slow reader never blocks the analysis and only loses the states it did not read in time.
+ */
+
+#include "../include/BallStateRing.h"
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Function to build the name of the shared-memory object, which must start with a slash
+static std::string shmName(const std::string& name) {
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+// Function to mark the ring of a previous producer as retired, so that its readers switch to the new ring
+static void retireRing(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(BallStateRingHeader)) {
+        void* memory = mmap(nullptr, sizeof(BallStateRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory != MAP_FAILED) {
+            auto* header = static_cast<BallStateRingHeader*>(memory);
+            if (header->magic == kBallStateRingMagic && header->version == kBallStateRingVersion) {
+                header->retired.store(1, std::memory_order_release);
+            }
+            munmap(memory, sizeof(BallStateRingHeader));
+        }
+    }
+    ::close(fd);
+}
+
+// Function to get the inode of the object currently named name, 0 when there is none
+static ino_t ringInode(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return 0;
+    struct stat info;
+    ino_t inode = fstat(fd, &info) == 0 ? info.st_ino : 0;
+    ::close(fd);
+    return inode;
+}
+
+
+BallStatePublisher::~BallStatePublisher() {
+    close();
+}
+
+bool BallStatePublisher::open(const std::string& name, int map_width, int map_height, uint32_t slot_count) {
+    close();
+    name_ = shmName(name);
+    if (slot_count == 0) slot_count = 1;
+    bytes_ = sizeof(BallStateRingHeader) + slot_count * sizeof(BallStateSlot);
+
+    // Create the ring again, the readers attached to the older ring see it retired and attach to the new one
+    retireRing(name_);
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        SVA_ERROR("Could not create the shared memory %s: %s", name_.c_str(), std::strerror(errno));
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || ftruncate(fd, static_cast<off_t>(bytes_)) != 0) {
+        SVA_ERROR("Could not resize the shared memory %s: %s", name_.c_str(), std::strerror(errno));
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        SVA_ERROR("Could not map the shared memory %s: %s", name_.c_str(), std::strerror(errno));
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    // The memory of a new object is zeroed, every slot starts with the sequence number 0
+    header_ = new (memory) BallStateRingHeader;
+    slots_ = reinterpret_cast<BallStateSlot*>(static_cast<char*>(memory) + sizeof(BallStateRingHeader));
+    header_->version = kBallStateRingVersion;
+    header_->slot_count = slot_count;
+    header_->slot_size = sizeof(BallStateSlot);
+    header_->map_width = map_width;
+    header_->map_height = map_height;
+    header_->retired.store(0, std::memory_order_relaxed);
+    header_->write_seq.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count; i++) new (&slots_[i].seq) std::atomic<uint64_t>(0);
+    // The magic number is written last, a reader checks it before using the header
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = kBallStateRingMagic;
+    inode_ = info.st_ino;
+    return true;
+}
+
+void BallStatePublisher::publish(const BallFrameState& balls) {
+    if (header_ == nullptr) return;
+    uint64_t n = header_->write_seq.load(std::memory_order_relaxed);
+    BallStateSlot& slot = slots_[n % header_->slot_count];
+
+    // Odd sequence number while the slot is written
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.state, &balls, sizeof(BallFrameState));
+    slot.seq.store(2 * n + 2, std::memory_order_release);
+    header_->write_seq.store(n + 1, std::memory_order_release);
+}
+
+void BallStatePublisher::close() {
+    if (header_ == nullptr) return;
+    header_->retired.store(1, std::memory_order_release);
+    munmap(header_, bytes_);
+    // The name may already belong to the ring of another producer
+    if (ringInode(name_) == inode_) shm_unlink(name_.c_str());
+    header_ = nullptr;
+    slots_ = nullptr;
+}
+
+
+BallStateReader::~BallStateReader() {
+    close();
+}
+
+bool BallStateReader::open(const std::string& name) {
+    close();
+    name_ = shmName(name);
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        // The producer may not have started yet
+        if (errno == ENOENT) {
+            SVA_DEBUG("The shared memory %s does not exist yet", name_.c_str());
+        } else {
+            SVA_ERROR("Could not open the shared memory %s: %s", name_.c_str(), std::strerror(errno));
+        }
+        return false;
+    }
+    if (!map(fd)) return false;
+    // Start from the states published from now on
+    next_ = header_->write_seq.load(std::memory_order_acquire);
+    lost_ = 0;
+    return true;
+}
+
+// Function to map the ring of an open shared-memory object, the descriptor is closed
+bool BallStateReader::map(int fd) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(BallStateRingHeader)) {
+        SVA_ERROR("The shared memory %s is not a ball state ring", name_.c_str());
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    void* memory = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        SVA_ERROR("Could not map the shared memory %s: %s", name_.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    auto* header = static_cast<const BallStateRingHeader*>(memory);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->magic != kBallStateRingMagic || header->version != kBallStateRingVersion ||
+        header->slot_size != sizeof(BallStateSlot) ||
+        bytes < sizeof(BallStateRingHeader) + header->slot_count * sizeof(BallStateSlot)) {
+        SVA_ERROR("The shared memory %s is not a compatible ball state ring", name_.c_str());
+        munmap(memory, bytes);
+        return false;
+    }
+    header_ = header;
+    slots_ = reinterpret_cast<const BallStateSlot*>(static_cast<const char*>(memory) + sizeof(BallStateRingHeader));
+    bytes_ = bytes;
+    inode_ = info.st_ino;
+    return true;
+}
+
+// Function to attach to the ring of a new producer once the current ring is retired and read,
+// tried at most every 100 ms. The states of the new ring are read from the first one.
+bool BallStateReader::reattach() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_attach_ < std::chrono::milliseconds(100)) return false;
+    last_attach_ = now;
+
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_ino == inode_) {
+        ::close(fd);
+        return false;
+    }
+    munmap(const_cast<BallStateRingHeader*>(header_), bytes_);
+    header_ = nullptr;
+    slots_ = nullptr;
+    if (!map(fd)) return false;
+    next_ = 0;
+    return true;
+}
+
+// Function to copy the state n, returns false when it was overwritten during the copy
+bool BallStateReader::readSlot(uint64_t seq, BallFrameState& balls) const {
+    const BallStateSlot& slot = slots_[seq % header_->slot_count];
+    uint64_t before = slot.seq.load(std::memory_order_acquire);
+    if (before != 2 * seq + 2) return false;
+    std::memcpy(&balls, &slot.state, sizeof(BallFrameState));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == before;
+}
+
+bool BallStateReader::next(BallFrameState& balls) {
+    if (header_ == nullptr) return false;
+    while (true) {
+        // The flag is read first, so that no state published before the retirement is missed
+        bool retired = header_->retired.load(std::memory_order_acquire);
+        uint64_t written = header_->write_seq.load(std::memory_order_acquire);
+        if (next_ >= written) {
+            if (retired && reattach()) continue;
+            return false;
+        }
+        // The states older than the ring were overwritten
+        if (written - next_ > header_->slot_count) {
+            lost_ += written - header_->slot_count - next_;
+            next_ = written - header_->slot_count;
+        }
+        if (readSlot(next_, balls)) {
+            next_++;
+            return true;
+        }
+        // Overwritten while it was copied, continue with the next state
+        lost_++;
+        next_++;
+    }
+}
+
+bool BallStateReader::latest(BallFrameState& balls) {
+    if (header_ == nullptr) return false;
+    while (true) {
+        bool retired = header_->retired.load(std::memory_order_acquire);
+        uint64_t written = header_->write_seq.load(std::memory_order_acquire);
+        if (next_ >= written) {
+            if (retired && reattach()) continue;
+            return false;
+        }
+        if (readSlot(written - 1, balls)) {
+            if (written - 1 > next_) lost_ += written - 1 - next_;
+            next_ = written;
+            return true;
+        }
+    }
+}
+
+void BallStateReader::close() {
+    if (header_ == nullptr) return;
+    munmap(const_cast<BallStateRingHeader*>(header_), bytes_);
+    header_ = nullptr;
+    slots_ = nullptr;
+}
@@ -0,0 +1,95 @@
+/*
+ * File:    DetectorConfig.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the DetectorConfig structure, which collects
+ *             the thresholds, radii and kernel sizes of the ball detection, with their loading and
+ *             saving in OpenCV YAML/XML files.
+ */
+
+#include "../include/DetectorConfig.h"
+#include <sstream>
+
+// Function to store a value in a field, an integer field only takes integral values in its range
+template <typename T>
+static bool assign(T& field, double value) {
+    if (std::is_integral<T>::value && (value != std::floor(value) || value < std::numeric_limits<T>::min() ||
+                                       value > std::numeric_limits<T>::max())) return false;
+    field = static_cast<T>(value);
+    return true;
+}
+
+bool DetectorConfig::set(const std::string& name, double value) {
+    bool stored = false;
+    visit([&](const char* key, auto& field) {
+        if (name == key) stored = assign(field, value);
+    });
+    return stored;
+}
+
+std::string DetectorConfig::describe() const {
+    std::ostringstream out;
+    visit([&](const char* key, const auto& field) {
+        out << key << "=" << field << " ";
+    });
+    std::string text = out.str();
+    if (!text.empty()) text.pop_back();
+    return text;
+}
+
+bool DetectorConfig::read(const cv::FileNode& node) {
+    bool ok = true;
+    visit([&](const char* key, auto& field) {
+        cv::FileNode value = node[key];
+        if (value.empty()) return;
+        double v = 0;
+        value >> v;
+        if (!assign(field, v)) {
+            SVA_ERROR("Invalid value %g for %s", v, key);
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+void DetectorConfig::write(cv::FileStorage& fs) const {
+    visit([&](const char* key, const auto& field) {
+        fs << key << field;
+    });
+}
+
+bool DetectorConfig::load(const std::string& filename) {
+    cv::FileStorage fs(filename, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        SVA_ERROR("Failed to load the detector configuration %s", filename.c_str());
+        return false;
+    }
+    if (!read(fs.root()) || !valid()) {
+        SVA_ERROR("Invalid detector configuration %s", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool DetectorConfig::save(const std::string& filename) const {
+    cv::FileStorage fs(filename, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        SVA_ERROR("Failed to save the detector configuration %s", filename.c_str());
+        return false;
+    }
+    write(fs);
+    return true;
+}
+
+bool DetectorConfig::valid() const {
+    return candidate_canny > 0 && candidate_votes > 0 && candidate_min_radius >= 0 &&
+           candidate_min_radius <= candidate_max_radius && min_dist_divisor > 0 && refine_window > 0 &&
+           refine_canny > 0 && refine_votes > 0 && refine_min_radius >= 0 && refine_min_radius <= refine_max_radius &&
+           median_size >= 3 && median_size % 2 == 1 && gaussian_sigma > 0 && canny_low <= canny_high &&
+           close_size > 0 && dilate_width > 0 && dilate_height > 0 && dilate_iterations >= 0 && background_absorb > 0;
+}
+
+int DetectorConfig::blurHalo() const {
+    // Size of the gaussian kernel chosen by OpenCV for 8-bit images
+    int gaussian_size = cvRound(gaussian_sigma * 3 * 2 + 1) | 1;
+    return median_size / 2 + gaussian_size / 2;
+}
@@ -0,0 +1,298 @@
+/*
+ * File:    EventDetection.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the EventDetection class.
+ *             The class tracks the balls on the minimap frame by frame and detects when the balls
+ *             start and stop moving, the collisions between balls and the balls pocketed in one of
+ *             the six holes. The frames with moving balls are grouped into shots, and the shots and
+ *             events are saved in an index file next to the output video.
+ */
+
+#include "../include/EventDetection.h"
+
+EventDetection::EventDetection(int width, int height) : area_(width, height) {
+    // Same holes drawn by BallDetection::draw_holes
+    pockets_.emplace_back(0, 0);
+    pockets_.emplace_back(width, 0);
+    pockets_.emplace_back(0, height / 2);
+    pockets_.emplace_back(width, height / 2);
+    pockets_.emplace_back(0, height);
+    pockets_.emplace_back(width, height);
+}
+
+void EventDetection::CellGrid::build(const std::vector<cv::Point2f>& points, float cell, const cv::Size& area) {
+    cell_ = std::max(cell, 1.0f);
+    cols_ = std::max(1, static_cast<int>(std::ceil(area.width / cell_)));
+    rows_ = std::max(1, static_cast<int>(std::ceil(area.height / cell_)));
+
+    // Counting sort of the points by cell
+    start_.assign(cols_ * rows_ + 1, 0);
+    for (const auto& p : points) start_[cellY(p.y) * cols_ + cellX(p.x) + 1]++;
+    for (size_t c = 1; c < start_.size(); c++) start_[c] += start_[c - 1];
+    next_.assign(start_.begin(), start_.end() - 1);
+    items_.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        items_[next_[cellY(points[i].y) * cols_ + cellX(points[i].x)]++] = static_cast<int>(i);
+    }
+}
+
+// Function to check if a position on the minimap is close to one of the holes
+bool EventDetection::nearPocket(const cv::Point2f& position) const {
+    for (const auto& pocket : pockets_) {
+        if (cv::norm(position - pocket) < pocket_dist_) return true;
+    }
+    return false;
+}
+
+void EventDetection::addEvent(int frame, EventType type, const Track& track, int other) {
+    events_.push_back({frame, type, track.id, other, track.position});
+}
+
+// Function to update the tracks and detect the events with the balls of a new analysed frame,
+// the id of the track of each ball is saved in the ball state
+void EventDetection::update(int frame, BallFrameState& balls) {
+    std::vector<cv::Point2f> minimapPositions;
+    for (int i = 0; i < balls.size(); i++) {
+        minimapPositions.push_back(balls.mapCenter(i));
+    }
+
+    // Number of video frames since the previous analysed frame
+    int dt = last_frame_ < 0 ? 1 : std::max(1, frame - last_frame_);
+    float gate = max_speed_ * static_cast<float>(dt);
+
+    // Associate the balls to the tracks, nearest pairs first. Only the balls in the cells of the
+    // gate around a track are candidates: the balls cannot overlap, so each track has a bounded
+    // number of candidates and the pairs grow linearly with the balls.
+    std::vector<std::pair<float, std::pair<size_t, size_t>>> pairs;
+    ball_grid_.build(minimapPositions, gate, area_);
+    for (size_t t = 0; t < tracks_.size(); t++) {
+        ball_grid_.forNear(tracks_[t].position, [&](int d) {
+            float dist = static_cast<float>(cv::norm(minimapPositions[d] - tracks_[t].position));
+            if (dist < gate) pairs.push_back({dist, {t, static_cast<size_t>(d)}});
+        });
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    std::vector<int> trackOf(minimapPositions.size(), -1);
+    std::vector<bool> matched(tracks_.size(), false);
+    for (const auto& p : pairs) {
+        size_t t = p.second.first;
+        size_t d = p.second.second;
+        if (matched[t] || trackOf[d] >= 0) continue;
+        matched[t] = true;
+        trackOf[d] = static_cast<int>(t);
+    }
+
+    // Update the matched tracks and detect the start and stop of the motion
+    bool active = false;
+    std::vector<size_t> kicked;
+    for (size_t d = 0; d < minimapPositions.size(); d++) {
+        if (trackOf[d] < 0) continue;
+        Track& track = tracks_[trackOf[d]];
+
+        cv::Point2f velocity = (minimapPositions[d] - track.position) * (1.0f / static_cast<float>(dt));
+        bool moving = cv::norm(velocity) > motion_speed_;
+        bool changed = cv::norm(velocity - track.velocity) > collision_dv_;
+
+        track.position = minimapPositions[d];
+        track.velocity = velocity;
+        track.label = balls.label[d];
+        track.missing = 0;
+        balls.track_id[d] = track.id;
+
+        if (moving && !track.moving) {
+            addEvent(frame, EVENT_MOTION_START, track, -1);
+        } else if (!moving && track.moving) {
+            addEvent(frame, EVENT_MOTION_STOP, track, -1);
+        }
+        if (changed && (moving || track.moving)) kicked.push_back(trackOf[d]);
+
+        track.moving = moving;
+        active = active || moving;
+    }
+
+    // A sudden change of velocity close to another ball is a collision, the other balls are
+    // looked up in the cells around the kicked ball
+    std::vector<int> collidedWith(tracks_.size(), -1);
+    if (!kicked.empty()) {
+        std::vector<cv::Point2f> trackPositions;
+        for (const auto& track : tracks_) trackPositions.push_back(track.position);
+        track_grid_.build(trackPositions, contact_dist_, area_);
+    }
+    for (size_t k : kicked) {
+        const Track& track = tracks_[k];
+        int other = -1;
+        float best = contact_dist_;
+        track_grid_.forNear(track.position, [&](int t) {
+            if (t == static_cast<int>(k) || !matched[t]) return;
+            float dist = static_cast<float>(cv::norm(tracks_[t].position - track.position));
+            if (dist < best) {
+                best = dist;
+                other = t;
+            }
+        });
+        // Each kicked ball has one collision, the pair is saved once when both balls are kicked
+        if (other < 0 || collidedWith[other] == static_cast<int>(k)) continue;
+        collidedWith[k] = other;
+        addEvent(frame, EVENT_COLLISION, track, tracks_[other].id);
+    }
+
+    // Balls that disappear while moving close to a hole are pocketed
+    std::vector<Track> kept;
+    for (size_t t = 0; t < tracks_.size(); t++) {
+        Track& track = tracks_[t];
+        if (!matched[t]) {
+            track.missing += dt;
+            if (track.missing >= pocket_frames_ && track.moving && nearPocket(track.position)) {
+                addEvent(frame, EVENT_POCKETED, track, -1);
+                continue;
+            }
+            if (track.missing >= lost_frames_) continue;
+        }
+        kept.push_back(track);
+    }
+    tracks_.swap(kept);
+
+    // New balls
+    for (size_t d = 0; d < minimapPositions.size(); d++) {
+        if (trackOf[d] >= 0) continue;
+        balls.track_id[d] = next_id_;
+        tracks_.push_back({next_id_++, balls.label[d], minimapPositions[d], cv::Point2f(0, 0), false, 0});
+    }
+
+    // Group the frames with moving balls into shots
+    if (active) {
+        // The motion started after the previous analysed frame
+        if (shot_start_ < 0) shot_start_ = last_frame_ < 0 ? frame : last_frame_;
+        last_motion_ = frame;
+    } else if (shot_start_ >= 0 && frame - last_motion_ >= rest_frames_) {
+        shots_.push_back({shot_start_, last_motion_});
+        shot_start_ = -1;
+    }
+
+    last_frame_ = frame;
+}
+
+// Function to close the shot still open at the end of the video
+void EventDetection::finish() {
+    if (shot_start_ >= 0) {
+        shots_.push_back({shot_start_, last_frame_});
+        shot_start_ = -1;
+    }
+}
+
+// Function to save the shots, the rest periods between them and the events
+bool EventDetection::saveIndex(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        SVA_ERROR("Failed to save the event index %s", filename.c_str());
+        return false;
+    }
+
+    static const char* names[] = {"start", "stop", "collision", "pocketed"};
+
+    file << "shots " << shots_.size() << "\n";
+    for (size_t i = 0; i < shots_.size(); i++) {
+        file << "shot " << shots_[i].start << " " << shots_[i].end << "\n";
+        if (i + 1 < shots_.size()) {
+            file << "rest " << shots_[i].end + 1 << " " << shots_[i + 1].start - 1 << "\n";
+        }
+    }
+
+    file << "events " << events_.size() << "\n";
+    for (const auto& event : events_) {
+        file << "event " << event.frame << " " << names[event.type] << " " << event.ball << " " << event.other
+             << " " << static_cast<int>(event.position.x) << " " << static_cast<int>(event.position.y) << "\n";
+    }
+
+    file.close();
+    return true;
+}
+
+// Function to restore the tracks, events and shots saved in a checkpoint
+bool EventDetection::read(const cv::FileStorage& fs) {
+    // Checkpoints saved before the integer columns were split from the positions
+    if (!fs["event_tracks"].empty() || !fs["event_list"].empty()) return false;
+
+    cv::Mat state, track_ids, track_motion, event_ids, event_positions, shots;
+    fs["event_state"] >> state;
+    fs["event_track_ids"] >> track_ids;
+    fs["event_track_motion"] >> track_motion;
+    fs["event_ids"] >> event_ids;
+    fs["event_positions"] >> event_positions;
+    fs["event_shots"] >> shots;
+    if (track_ids.rows != track_motion.rows || event_ids.rows != event_positions.rows) return false;
+    if ((!track_ids.empty() && (track_ids.type() != CV_32S || track_ids.cols != 4 || track_motion.type() != CV_32F ||
+                                track_motion.cols != 4)) ||
+        (!event_ids.empty() && (event_ids.type() != CV_32S || event_ids.cols != 4 || event_positions.type() != CV_32F ||
+                                event_positions.cols != 2)) ||
+        (!shots.empty() && (shots.type() != CV_32S || shots.cols != 2))) return false;
+
+    if (state.total() == 4) {
+        next_id_ = state.at<int>(0);
+        last_frame_ = state.at<int>(1);
+        shot_start_ = state.at<int>(2);
+        last_motion_ = state.at<int>(3);
+    }
+
+    tracks_.clear();
+    for (int i = 0; i < track_ids.rows; i++) {
+        const int* t = track_ids.ptr<int>(i);
+        const float* m = track_motion.ptr<float>(i);
+        tracks_.push_back({t[0], t[1], cv::Point2f(m[0], m[1]), cv::Point2f(m[2], m[3]), t[2] != 0, t[3]});
+    }
+    events_.clear();
+    for (int i = 0; i < event_ids.rows; i++) {
+        const int* e = event_ids.ptr<int>(i);
+        const float* p = event_positions.ptr<float>(i);
+        events_.push_back({e[0], static_cast<EventType>(e[1]), e[2], e[3], cv::Point2f(p[0], p[1])});
+    }
+    shots_.clear();
+    for (int i = 0; i < shots.rows; i++) {
+        shots_.push_back({shots.at<int>(i, 0), shots.at<int>(i, 1)});
+    }
+    return true;
+}
+
+// Function to save the tracks, events and shots in a checkpoint. The identifiers, labels and frame
+// indices are stored as integers, only the positions and velocities as floats
+void EventDetection::write(cv::FileStorage& fs) const {
+    cv::Mat state(1, 4, CV_32S);
+    state.at<int>(0) = next_id_;
+    state.at<int>(1) = last_frame_;
+    state.at<int>(2) = shot_start_;
+    state.at<int>(3) = last_motion_;
+
+    int track_count = static_cast<int>(tracks_.size());
+    cv::Mat track_ids(track_count, 4, CV_32S), track_motion(track_count, 4, CV_32F);
+    for (int i = 0; i < track_count; i++) {
+        const Track& t = tracks_[i];
+        int ids[] = {t.id, t.label, t.moving ? 1 : 0, t.missing};
+        float motion[] = {t.position.x, t.position.y, t.velocity.x, t.velocity.y};
+        std::copy(ids, ids + 4, track_ids.ptr<int>(i));
+        std::copy(motion, motion + 4, track_motion.ptr<float>(i));
+    }
+    int event_count = static_cast<int>(events_.size());
+    cv::Mat event_ids(event_count, 4, CV_32S), event_positions(event_count, 2, CV_32F);
+    for (int i = 0; i < event_count; i++) {
+        const BallEvent& e = events_[i];
+        int ids[] = {e.frame, static_cast<int>(e.type), e.ball, e.other};
+        std::copy(ids, ids + 4, event_ids.ptr<int>(i));
+        event_positions.at<float>(i, 0) = e.position.x;
+        event_positions.at<float>(i, 1) = e.position.y;
+    }
+    cv::Mat shots(static_cast<int>(shots_.size()), 2, CV_32S);
+    for (size_t i = 0; i < shots_.size(); i++) {
+        shots.at<int>(static_cast<int>(i), 0) = shots_[i].start;
+        shots.at<int>(static_cast<int>(i), 1) = shots_[i].end;
+    }
+
+    fs << "event_state" << state;
+    fs << "event_track_ids" << track_ids;
+    fs << "event_track_motion" << track_motion;
+    fs << "event_ids" << event_ids;
+    fs << "event_positions" << event_positions;
+    fs << "event_shots" << shots;
+}
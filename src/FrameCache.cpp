@@ -0,0 +1,131 @@
+/*
+ * File:    FrameCache.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the frame cache used by the parameter sweep.
+ *             A range of the video is decoded once into a file of raw BGR frames, which is then mapped
+ *             in memory and shared by all the threads and all the configurations of the sweep.
+ */
+
+#include "../include/FrameCache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint32_t kFrameCacheVersion = 1;
+// The frames start on a page boundary
+static const size_t kFrameCacheDataOffset = 4096;
+
+FrameCache::~FrameCache() {
+    close();
+}
+
+bool FrameCache::build(const std::string& video_path, const std::string& path, int start, int count, int stride) {
+    cv::VideoCapture capture(video_path);
+    if (!capture.isOpened()) {
+        SVA_ERROR("Could not open the video %s", video_path.c_str());
+        return false;
+    }
+    if (stride < 1) stride = 1;
+    if (start > 0) capture.set(cv::CAP_PROP_POS_FRAMES, start);
+
+    // Written to a temporary file first, so that an interrupted build never leaves a valid cache
+    std::string tmp = path + ".tmp";
+    FILE* file = std::fopen(tmp.c_str(), "wb");
+    if (file == nullptr) {
+        SVA_ERROR("Could not create the frame cache %s", path.c_str());
+        return false;
+    }
+    FrameCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SVAF", 4);
+    header.version = kFrameCacheVersion;
+    header.start = start;
+    header.stride = stride;
+    header.requested = count;
+    header.fps = capture.get(cv::CAP_PROP_FPS);
+    std::fseek(file, static_cast<long>(kFrameCacheDataOffset), SEEK_SET);
+
+    bool ok = true;
+    cv::Mat frame;
+    while (ok && header.count < count) {
+        capture >> frame;
+        if (frame.empty()) break;
+        if (header.count == 0) {
+            header.width = frame.cols;
+            header.height = frame.rows;
+        }
+        if (frame.type() != CV_8UC3 || frame.cols != header.width || frame.rows != header.height) {
+            SVA_ERROR("Frame %d of %s has another size or type", start + header.count * stride, video_path.c_str());
+            ok = false;
+            break;
+        }
+        for (int y = 0; y < frame.rows && ok; y++) {
+            ok = std::fwrite(frame.ptr(y), frame.elemSize(), frame.cols, file) == static_cast<size_t>(frame.cols);
+        }
+        header.count++;
+        // The skipped frames are only grabbed
+        for (int s = 1; s < stride; s++) capture.grab();
+    }
+
+    std::fseek(file, 0, SEEK_SET);
+    ok = ok && std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || header.count == 0 || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        SVA_ERROR("Could not write the frame cache %s", path.c_str());
+        std::remove(tmp.c_str());
+        return false;
+    }
+    SVA_INFO("Cached %d frames of %s in %s", header.count, video_path.c_str(), path.c_str());
+    return true;
+}
+
+bool FrameCache::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kFrameCacheDataOffset) {
+        ::close(fd);
+        return false;
+    }
+    bytes_ = static_cast<size_t>(st.st_size);
+    // Read-only mapping, shared by all the threads and the configurations
+    void* memory = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        SVA_ERROR("Could not map the frame cache %s: %s", path.c_str(), std::strerror(errno));
+        bytes_ = 0;
+        return false;
+    }
+    memory_ = memory;
+    header_ = static_cast<const FrameCacheHeader*>(memory_);
+
+    size_t frame_bytes = static_cast<size_t>(header_->width) * header_->height * 3;
+    if (std::memcmp(header_->magic, "SVAF", 4) != 0 || header_->version != kFrameCacheVersion ||
+        header_->count <= 0 || kFrameCacheDataOffset + header_->count * frame_bytes > bytes_) {
+        SVA_ERROR("Invalid frame cache %s", path.c_str());
+        close();
+        return false;
+    }
+    // Every configuration reads the frames in order
+    madvise(memory_, bytes_, MADV_WILLNEED);
+    return true;
+}
+
+void FrameCache::close() {
+    if (memory_ != nullptr) munmap(memory_, bytes_);
+    memory_ = nullptr;
+    header_ = nullptr;
+    bytes_ = 0;
+}
+
+cv::Mat FrameCache::frame(int i) const {
+    if (header_ == nullptr || i < 0 || i >= header_->count) return cv::Mat();
+    size_t frame_bytes = static_cast<size_t>(header_->width) * header_->height * 3;
+    char* data = static_cast<char*>(memory_) + kFrameCacheDataOffset + i * frame_bytes;
+    return cv::Mat(header_->height, header_->width, CV_8UC3, data);
+}
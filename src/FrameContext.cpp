@@ -0,0 +1,90 @@
+/*
+ * File:    FrameContext.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the FrameContext class, which computes the
+ *             planes derived from a frame (grayscale, red channel, XYZ, blurred grayscale and edges)
+ *             on demand and at most once per frame, for the table detection, the ball detection and
+ *             the refinement of the balls.
+ */
+
+#include "../include/FrameContext.h"
+#include "../include/TileFilter.h"
+
+void FrameContext::reset(const cv::Mat& frame, const TableSpans& spans, const DetectorConfig& config) {
+    frame_ = frame;
+    spans_ = &spans;
+    config_ = &config;
+    for (bool& ready : ready_) ready = false;
+}
+
+const cv::Mat& FrameContext::gray() {
+    if (!ready_[GRAY]) {
+        cv::cvtColor(frame_, planes_[GRAY], cv::COLOR_BGR2GRAY);
+        ready_[GRAY] = true;
+    }
+    return planes_[GRAY];
+}
+
+const cv::Mat& FrameContext::red() {
+    if (!ready_[RED]) {
+        cv::extractChannel(frame_, planes_[RED], 2);
+        ready_[RED] = true;
+    }
+    return planes_[RED];
+}
+
+const cv::Mat& FrameContext::tableGray() {
+    if (!ready_[TABLE_GRAY]) {
+        // The conversion is per pixel, masking the grayscale frame gives the grayscale of the table
+        spans_->copy(gray(), planes_[TABLE_GRAY]);
+        ready_[TABLE_GRAY] = true;
+    }
+    return planes_[TABLE_GRAY];
+}
+
+const cv::Mat& FrameContext::blurred() {
+    if (!ready_[BLURRED]) {
+        // Median Blur to reduce noise and Gaussian Blur to smooth the image, both on each tile
+        const DetectorConfig& config = *config_;
+        parallelTileFilter(tableGray(), planes_[BLURRED], config.blurHalo(), [&config](const cv::Mat& src, cv::Mat& dst) {
+            cv::medianBlur(src, dst, config.median_size);
+            cv::GaussianBlur(dst, dst, cv::Size(0, 0), config.gaussian_sigma);
+        });
+        ready_[BLURRED] = true;
+    }
+    return planes_[BLURRED];
+}
+
+const cv::Mat& FrameContext::edges() {
+    if (!ready_[EDGES]) {
+        // The hysteresis of Canny follows the edges across the whole image, it is not tiled
+        cv::Canny(blurred(), planes_[EDGES], config_->canny_low, config_->canny_high);
+        ready_[EDGES] = true;
+    }
+    return planes_[EDGES];
+}
+
+const cv::Mat& FrameContext::packedTable() {
+    if (!ready_[PACKED_TABLE]) {
+        spans_->pack(frame_, planes_[PACKED_TABLE]);
+        ready_[PACKED_TABLE] = true;
+    }
+    return planes_[PACKED_TABLE];
+}
+
+const cv::Mat& FrameContext::packedGray() {
+    if (!ready_[PACKED_GRAY]) {
+        spans_->pack(gray(), planes_[PACKED_GRAY]);
+        ready_[PACKED_GRAY] = true;
+    }
+    return planes_[PACKED_GRAY];
+}
+
+const cv::Mat& FrameContext::xyz() {
+    if (!ready_[XYZ]) {
+        // Only the pixels of the table are converted
+        cv::cvtColor(packedTable(), planes_[XYZ], cv::COLOR_BGR2XYZ);
+        ready_[XYZ] = true;
+    }
+    return planes_[XYZ];
+}
@@ -0,0 +1,133 @@
+/*
+ * File:    Logger.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the Logger class.
+ *             Each thread formats its messages into its own single-producer ring buffer, with the
+ *             frame and ball being processed. A background thread drains all the rings, orders the
+ *             messages by time and writes them to stderr, so that the frame loop never blocks on
+ *             the output and the messages of different threads are never interleaved.
+ */
+
+#include "../include/Logger.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+thread_local int tls_frame = -1;
+thread_local int tls_ball = -1;
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : start_(std::chrono::steady_clock::now()) {
+    worker_ = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+    running_.store(false);
+    wake_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+void Logger::setFrame(int frame) { tls_frame = frame; }
+void Logger::setBall(int ball) { tls_ball = ball; }
+int Logger::frame() { return tls_frame; }
+int Logger::ball() { return tls_ball; }
+
+// Ring of a thread, retired when the thread exits so that the background thread frees it
+// once its last messages are written
+struct RingOwner {
+    Logger::Ring* ring = nullptr;
+    ~RingOwner() {
+        if (ring != nullptr) ring->retired.store(true, std::memory_order_release);
+    }
+};
+
+// Function to get the ring of the calling thread, registered on its first message
+Logger::Ring* Logger::localRing() {
+    thread_local RingOwner owner;
+    if (owner.ring == nullptr) {
+        std::unique_ptr<Ring> created(new Ring());
+        owner.ring = created.get();
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(std::move(created));
+    }
+    return owner.ring;
+}
+
+void Logger::write(int level, const char* format, ...) {
+    Ring* ring = localRing();
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t tail = ring->tail.load(std::memory_order_acquire);
+    // Never wait for the background thread
+    if (head - tail >= Ring::kSize) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogRecord& record = ring->records[head & (Ring::kSize - 1)];
+    record.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+    record.level = level;
+    record.frame = tls_frame;
+    record.ball = tls_ball;
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(record.message, sizeof(record.message), format, args);
+    va_end(args);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+// Function to write the pending messages of all the threads, returns the number of messages
+size_t Logger::drain() {
+    static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    std::vector<LogRecord> batch;
+    uint32_t dropped = 0;
+    for (auto& ring : rings_) {
+        // A ring retired before it is drained has no message left after this pass
+        bool retired = ring->retired.load(std::memory_order_acquire);
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            batch.push_back(ring->records[tail & (Ring::kSize - 1)]);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (retired) ring.reset();
+    }
+    rings_.erase(std::remove(rings_.begin(), rings_.end(), nullptr), rings_.end());
+    if (batch.empty() && dropped == 0) return 0;
+
+    std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+        return a.time_us < b.time_us;
+    });
+    for (const auto& record : batch) {
+        std::fprintf(stderr, "[%10.3f] %-5s ", record.time_us / 1e6, names[std::min(std::max(record.level, 0), 3)]);
+        if (record.frame >= 0) std::fprintf(stderr, "frame=%d ", record.frame);
+        if (record.ball >= 0) std::fprintf(stderr, "ball=%d ", record.ball);
+        std::fprintf(stderr, "%s\n", record.message);
+    }
+    if (dropped > 0) std::fprintf(stderr, "[logger] %u messages dropped\n", dropped);
+    std::fflush(stderr);
+    return batch.size();
+}
+
+// Function to write all the pending messages before returning
+void Logger::flush() {
+    drain();
+}
+
+void Logger::run() {
+    while (running_.load()) {
+        drain();
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    drain();
+}
@@ -0,0 +1,163 @@
+/*
+ * File:    OutputSink.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the output sinks used by process_video.
+ *             A sink receives the composed output frames and can encode them with cv::VideoWriter,
+ *             save them as an image sequence, write them raw (BGR or Y4M) to a pipe for an external
+ *             encoder, or discard them to benchmark the analysis.
+ */
+
+#include "../include/OutputSink.h"
+
+// Function to build the name of a file saved next to the output video
+std::string outputName(const std::string& output_path, const std::string& suffix) {
+    size_t slash = output_path.find_last_of("/\\");
+    size_t dot = output_path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return output_path + suffix;
+    }
+    return output_path.substr(0, dot) + suffix;
+}
+
+// Function to build the name of an output segment: video.mp4 -> video_part000.mp4
+std::string segmentName(const std::string& output_path, int segment) {
+    char part[16];
+    std::snprintf(part, sizeof(part), "_part%03d", segment);
+    std::string base = outputName(output_path, part);
+    size_t slash = output_path.find_last_of("/\\");
+    size_t dot = output_path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return base;
+    return base + output_path.substr(dot);
+}
+
+
+VideoWriterSink::VideoWriterSink(const std::string& codec) {
+    // createSink checks that a given codec is a fourcc
+    std::string c = codec.empty() ? "mp4v" : codec;
+    fourcc_ = cv::VideoWriter::fourcc(c[0], c[1], c[2], c[3]);
+}
+
+bool VideoWriterSink::open(const std::string& path, double fps, const cv::Size& size) {
+    if (!writer_.open(path, fourcc_, fps, size) || !writer_.isOpened()) {
+        SVA_ERROR("Could not open the output video %s", path.c_str());
+        return false;
+    }
+    size_ = size;
+    return true;
+}
+
+bool VideoWriterSink::write(const cv::Mat& frame, int frame_index) {
+    // VideoWriter drops a frame of another size without an error
+    if (!writer_.isOpened() || frame.size() != size_) return false;
+    writer_.write(frame);
+    return true;
+}
+
+void VideoWriterSink::close() {
+    writer_.release();
+}
+
+
+ImageSequenceSink::ImageSequenceSink(const std::string& extension, int compression) : extension_(extension) {
+    if (extension_.empty()) extension_ = "png";
+    // Compression level 0-9 for png, quality 0-100 for jpg
+    if (compression >= 0) {
+        if (extension_ == "png") {
+            params_ = {cv::IMWRITE_PNG_COMPRESSION, compression};
+        } else if (extension_ == "jpg" || extension_ == "jpeg") {
+            params_ = {cv::IMWRITE_JPEG_QUALITY, compression};
+        }
+    }
+}
+
+bool ImageSequenceSink::open(const std::string& path, double fps, const cv::Size& size) {
+    prefix_ = outputName(path, "_");
+    return true;
+}
+
+bool ImageSequenceSink::write(const cv::Mat& frame, int frame_index) {
+    char index[16];
+    std::snprintf(index, sizeof(index), "%06d", frame_index);
+    std::string name = prefix_ + index + "." + extension_;
+    if (!cv::imwrite(name, frame, params_)) {
+        SVA_ERROR("Could not save %s", name.c_str());
+        return false;
+    }
+    return true;
+}
+
+void ImageSequenceSink::close() {}
+
+
+PipeSink::PipeSink(Format format) : format_(format) {}
+
+PipeSink::~PipeSink() {
+    close();
+}
+
+bool PipeSink::open(const std::string& path, double fps, const cv::Size& size) {
+    if (format_ == Y4M && (size.width % 2 != 0 || size.height % 2 != 0)) {
+        SVA_ERROR("Y4M output needs an even frame size");
+        return false;
+    }
+    file_ = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        SVA_ERROR("Could not open the output pipe %s", path.c_str());
+        return false;
+    }
+    if (format_ == Y4M) {
+        // Frame rate as a fraction with millisecond precision
+        int fps_num = static_cast<int>(fps * 1000 + 0.5);
+        std::fprintf(file_, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg\n", size.width, size.height, fps_num);
+    }
+    return true;
+}
+
+bool PipeSink::write(const cv::Mat& frame, int frame_index) {
+    if (file_ == nullptr) return false;
+
+    const cv::Mat* data = &frame;
+    if (format_ == Y4M) {
+        std::fputs("FRAME\n", file_);
+        cv::cvtColor(frame, yuv_, cv::COLOR_BGR2YUV_I420);
+        data = &yuv_;
+    }
+    // The frames written by process_video are continuous
+    cv::Mat continuous = data->isContinuous() ? *data : data->clone();
+    size_t bytes = continuous.total() * continuous.elemSize();
+    return std::fwrite(continuous.data, 1, bytes, file_) == bytes;
+}
+
+void PipeSink::close() {
+    if (file_ == nullptr) return;
+    if (file_ == stdout) {
+        std::fflush(file_);
+    } else {
+        std::fclose(file_);
+    }
+    file_ = nullptr;
+}
+
+
+// Function to create a sink from its name: video, images, raw, y4m or null
+std::unique_ptr<OutputSink> createSink(const std::string& type, const std::string& codec, int compression) {
+    if (type == "video") {
+        if (!codec.empty() && codec.size() != 4) {
+            SVA_ERROR("Invalid codec %s, the video sink needs a fourcc such as mp4v", codec.c_str());
+            return nullptr;
+        }
+        return std::unique_ptr<OutputSink>(new VideoWriterSink(codec));
+    }
+    if (type == "images") {
+        if (!codec.empty() && !cv::haveImageWriter("." + codec)) {
+            SVA_ERROR("Invalid image format %s for the images sink", codec.c_str());
+            return nullptr;
+        }
+        return std::unique_ptr<OutputSink>(new ImageSequenceSink(codec, compression));
+    }
+    if (type == "raw") return std::unique_ptr<OutputSink>(new PipeSink(PipeSink::RAW_BGR));
+    if (type == "y4m") return std::unique_ptr<OutputSink>(new PipeSink(PipeSink::Y4M));
+    if (type == "null") return std::unique_ptr<OutputSink>(new NullSink());
+    SVA_ERROR("Unknown output sink %s", type.c_str());
+    return nullptr;
+}
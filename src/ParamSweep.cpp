@@ -0,0 +1,348 @@
+/*
+ * File:    ParamSweep.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the parameter sweep used to tune the ball detection. A range of the
+ *             video is decoded once into a mapped frame cache, then every configuration of a grid is
+ *             run on the cached frames by a pool of threads and scored against ground-truth boxes.
+ *             The precision, recall, F1, label accuracy and time per frame of each configuration are
+ *             printed as CSV, and the chosen configuration can be saved for Starter --config.
+ */
+
+#include "../include/header.h"
+#include "../include/BallDetection.h"
+#include "../include/FrameCache.h"
+#include "../include/ArgParse.h"
+#include <atomic>
+#include <map>
+#include <thread>
+
+// Ball of the ground truth: bounding box and label, as saved by saveDetections
+struct TruthBall {
+    cv::Point2f center;
+    int label;
+};
+
+// Score and cost of one configuration of the grid
+struct SweepResult {
+    DetectorConfig config;
+    std::vector<double> values;     // values of the swept parameters
+    long true_positives = 0;
+    long false_positives = 0;
+    long false_negatives = 0;
+    long labels_correct = 0;        // true positives with the label of the ground truth
+    int failed = 0;                 // frames where the detection failed
+    double ms = 0;                  // total detection time
+    int frames = 0;
+    bool pareto = false;            // no other configuration is both more accurate and faster
+
+    double precision() const { return ratio(true_positives, true_positives + false_positives); }
+    double recall() const { return ratio(true_positives, true_positives + false_negatives); }
+    double f1() const {
+        double p = precision(), r = recall();
+        return p + r > 0 ? 2 * p * r / (p + r) : 0;
+    }
+    double labelAccuracy() const { return ratio(labels_correct, true_positives); }
+    double msPerFrame() const { return frames > 0 ? ms / frames : 0; }
+
+private:
+    static double ratio(long a, long b) { return b > 0 ? static_cast<double>(a) / b : 0; }
+};
+
+
+// Function to print the usage of the program
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " < Input video path > " << " < Ground truth > " << " < Grid file > "
+              << " [--start < frame >] [--frames < N >] [--stride < K >] [--threads < N >] [--cache < file >]"
+              << " [--config < file >] [--tolerance < px >] [--min-f1 < value >] [--save-best < file >] [--verbose]"
+              << std::endl;
+}
+
+// Function to load the ground truth: one line "frame x y w h label" per ball
+bool loadGroundTruth(const std::string& path, std::map<int, std::vector<TruthBall>>& truth) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        SVA_ERROR("Could not open the ground truth %s", path.c_str());
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        int frame, x, y, w, h, label;
+        if (std::sscanf(line.c_str(), "%d %d %d %d %d %d", &frame, &x, &y, &w, &h, &label) != 6) continue;
+        truth[frame].push_back({cv::Point2f(x + w / 2.0f, y + h / 2.0f), label});
+    }
+    if (truth.empty()) {
+        SVA_ERROR("No ball in the ground truth %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Function to load the grid: one sequence of values per parameter of DetectorConfig
+bool loadGrid(const std::string& path, std::vector<std::string>& names, std::vector<std::vector<double>>& values) {
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        SVA_ERROR("Could not open the grid %s", path.c_str());
+        return false;
+    }
+    DetectorConfig probe;
+    for (cv::FileNode node : fs.root()) {
+        std::string name = node.name();
+        if (!probe.set(name, 0)) {
+            SVA_ERROR("Unknown parameter %s in the grid", name.c_str());
+            return false;
+        }
+        std::vector<double> list;
+        if (node.isSeq()) {
+            for (cv::FileNode value : node) list.push_back(static_cast<double>(value));
+        } else {
+            list.push_back(static_cast<double>(node));
+        }
+        // An integer parameter only takes integral values
+        for (double value : list) {
+            if (!probe.set(name, value)) {
+                SVA_ERROR("Invalid value %g for %s in the grid", value, name.c_str());
+                return false;
+            }
+        }
+        if (list.empty()) continue;
+        names.push_back(name);
+        values.push_back(list);
+    }
+    return true;
+}
+
+// Function to score the balls of a frame: each ball of the ground truth is matched to the closest
+// detection within the tolerance, every detection is matched at most once
+void scoreFrame(const BallFrameState& balls, const std::vector<TruthBall>& truth, float tolerance, SweepResult& result) {
+    struct Pair { float distance; int ball; int truth; };
+    std::vector<Pair> pairs;
+    for (int b = 0; b < balls.size(); b++) {
+        for (size_t t = 0; t < truth.size(); t++) {
+            cv::Point2f d = balls.center(b) - truth[t].center;
+            float distance = std::sqrt(d.x * d.x + d.y * d.y);
+            if (distance <= tolerance) pairs.push_back({distance, b, static_cast<int>(t)});
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.distance < b.distance; });
+
+    std::vector<bool> ball_used(balls.size(), false), truth_used(truth.size(), false);
+    long matched = 0;
+    for (const Pair& p : pairs) {
+        if (ball_used[p.ball] || truth_used[p.truth]) continue;
+        ball_used[p.ball] = true;
+        truth_used[p.truth] = true;
+        matched++;
+        if (balls.label[p.ball] == truth[p.truth].label) result.labels_correct++;
+    }
+    result.true_positives += matched;
+    result.false_positives += balls.size() - matched;
+    result.false_negatives += static_cast<long>(truth.size()) - matched;
+}
+
+
+int main(int argc, char** argv) {
+
+    if (argc < 4) {
+        printUsage(argv[0]);
+        return -1;
+    }
+    std::string video_path = argv[1];
+
+    // Parse the optional arguments
+    int start = 0, frames = 300, stride = 1;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::string cache_path = outputName(video_path, ".frames");
+    std::string best_path;
+    double tolerance = 6;
+    double min_f1 = -1;
+    DetectorConfig base;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--verbose") {
+            Logger::instance().setLevel(LOG_LEVEL_DEBUG);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return -1;
+        }
+        bool valid = true;
+        if (arg == "--start") {
+            valid = parseInt(argv[++i], 0, start);
+        } else if (arg == "--frames") {
+            valid = parseInt(argv[++i], 1, frames);
+        } else if (arg == "--stride") {
+            valid = parseInt(argv[++i], 1, stride);
+        } else if (arg == "--threads") {
+            valid = parseInt(argv[++i], 1, threads);
+        } else if (arg == "--cache") {
+            cache_path = argv[++i];
+        } else if (arg == "--config") {
+            if (!base.load(argv[++i])) return -1;
+        } else if (arg == "--tolerance") {
+            valid = parseDouble(argv[++i], 0, tolerance);
+        } else if (arg == "--min-f1") {
+            valid = parseDouble(argv[++i], 0, min_f1) && min_f1 <= 1;
+        } else if (arg == "--save-best") {
+            best_path = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return -1;
+        }
+        if (!valid) {
+            SVA_ERROR("Invalid value %s for %s", argv[i], arg.c_str());
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    std::map<int, std::vector<TruthBall>> truth;
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> grid;
+    if (!loadGroundTruth(argv[2], truth) || !loadGrid(argv[3], names, grid)) return -1;
+
+    // Decode the range once, a cache of the same range is reused
+    FrameCache cache;
+    bool cached = cache.open(cache_path) && cache.header().start == start && cache.header().stride == stride &&
+                  cache.header().requested == frames;
+    if (!cached) {
+        cache.close();
+        if (!FrameCache::build(video_path, cache_path, start, frames, stride) || !cache.open(cache_path)) return -1;
+    }
+    int scored = 0;
+    long truth_balls = 0;
+    for (int i = 0; i < cache.size(); i++) {
+        auto it = truth.find(cache.frameIndex(i));
+        if (it == truth.end()) continue;
+        scored++;
+        truth_balls += static_cast<long>(it->second.size());
+    }
+    if (scored == 0) {
+        SVA_ERROR("No cached frame is in the ground truth");
+        return -1;
+    }
+
+    // The table is detected once on the first frame and shared by all the configurations
+    cv::Mat first = cache.frame(0);
+    BallDetection setup;
+    TableDetection vp(&setup);
+    if (!vp.detectTableCorners(first)) {
+        SVA_ERROR("Could not detect table corners");
+        return -1;
+    }
+    std::vector<cv::Point2f> sortedCorners = sortCorners(vp.tableCorners_);
+    std::vector<cv::Point> corners(sortedCorners.begin(), sortedCorners.end());
+    cv::Mat black = cv::Mat::zeros(first.size(), CV_8UC1);
+    cv::fillConvexPoly(black, corners, cv::Scalar(5, 5, 5));
+    TableSpans table_spans;
+    table_spans.build(black, cv::boundingRect(sortedCorners));
+
+    // Cartesian product of the values of the grid
+    std::vector<SweepResult> results(1);
+    results[0].config = base;
+    for (size_t p = 0; p < names.size(); p++) {
+        std::vector<SweepResult> expanded;
+        for (const SweepResult& r : results) {
+            for (double value : grid[p]) {
+                SweepResult e = r;
+                e.config.set(names[p], value);
+                e.values.push_back(value);
+                expanded.push_back(e);
+            }
+        }
+        results.swap(expanded);
+    }
+    // Combinations that OpenCV would reject, such as an even median size, are skipped
+    size_t combinations = results.size();
+    results.erase(std::remove_if(results.begin(), results.end(), [](const SweepResult& r) { return !r.config.valid(); }),
+                  results.end());
+    if (results.size() < combinations) SVA_WARN("Skipped %zu invalid configurations", combinations - results.size());
+    if (results.empty()) {
+        SVA_ERROR("No valid configuration in the grid");
+        return -1;
+    }
+    SVA_INFO("Sweeping %zu configurations on %d frames (%d with ground truth) with %d threads", results.size(),
+             cache.size(), scored, threads);
+
+    // The configurations run in parallel, the filters of each one on its own thread
+    if (threads > 1) cv::setNumThreads(1);
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> done(0);
+    auto worker = [&]() {
+        for (size_t c = next++; c < results.size(); c = next++) {
+            SweepResult& result = results[c];
+            BallDetection bd;
+            bd.setConfig(result.config);
+            try {
+                for (int i = 0; i < cache.size(); i++) {
+                    int frame_index = cache.frameIndex(i);
+                    LogScope scope(frame_index);
+                    double t = static_cast<double>(cv::getTickCount());
+                    bool ok = bd.detectBalls(cache.frame(i), table_spans);
+                    result.ms += (static_cast<double>(cv::getTickCount()) - t) * 1000.0 / cv::getTickFrequency();
+                    result.frames++;
+
+                    auto it = truth.find(frame_index);
+                    if (it == truth.end()) continue;
+                    if (!ok) {
+                        result.failed++;
+                        result.false_negatives += static_cast<long>(it->second.size());
+                        continue;
+                    }
+                    scoreFrame(bd.balls(), it->second, static_cast<float>(tolerance), result);
+                }
+            } catch (const cv::Exception& e) {
+                // A configuration rejected by OpenCV fails on every frame of the ground truth,
+                // the other configurations go on
+                SVA_ERROR("Configuration %s failed: %s", result.config.describe().c_str(), e.what());
+                result.true_positives = 0;
+                result.false_positives = 0;
+                result.labels_correct = 0;
+                result.false_negatives = truth_balls;
+                result.failed = scored;
+            }
+            SVA_INFO("Configuration %zu/%zu: F1 %.4f, %.2f ms per frame", ++done, results.size(), result.f1(),
+                     result.msPerFrame());
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) pool.emplace_back(worker);
+    for (std::thread& t : pool) t.join();
+
+    // Configurations on the front of accuracy against cost
+    for (SweepResult& r : results) {
+        r.pareto = std::none_of(results.begin(), results.end(), [&](const SweepResult& o) {
+            return o.f1() >= r.f1() && o.msPerFrame() <= r.msPerFrame() &&
+                   (o.f1() > r.f1() || o.msPerFrame() < r.msPerFrame());
+        });
+    }
+
+    // CSV report on stdout
+    for (const std::string& name : names) std::cout << name << ",";
+    std::cout << "precision,recall,f1,label_accuracy,ms_per_frame,failed_frames,pareto" << std::endl;
+    for (const SweepResult& r : results) {
+        for (double value : r.values) std::cout << value << ",";
+        std::cout << r.precision() << "," << r.recall() << "," << r.f1() << "," << r.labelAccuracy() << ","
+                  << r.msPerFrame() << "," << r.failed << "," << (r.pareto ? 1 : 0) << std::endl;
+    }
+
+    // The fastest configuration reaching the minimum F1, or the most accurate one
+    const SweepResult* best = nullptr;
+    for (const SweepResult& r : results) {
+        if (min_f1 >= 0) {
+            if (r.f1() >= min_f1 && (best == nullptr || r.msPerFrame() < best->msPerFrame())) best = &r;
+        } else if (best == nullptr || r.f1() > best->f1() || (r.f1() == best->f1() && r.msPerFrame() < best->msPerFrame())) {
+            best = &r;
+        }
+    }
+    if (best == nullptr) {
+        SVA_WARN("No configuration reaches an F1 of %.3f", min_f1);
+        return 0;
+    }
+    SVA_INFO("Best: F1 %.4f, %.2f ms per frame, %s", best->f1(), best->msPerFrame(), best->config.describe().c_str());
+    if (!best_path.empty() && best->config.save(best_path)) {
+        SVA_INFO("Saved the configuration in %s", best_path.c_str());
+    }
+
+    return 0;
+}
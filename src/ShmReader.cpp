@@ -0,0 +1,54 @@
+/*
+ * File:    ShmReader.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains a small consumer of the ball state ring published by Starter with
+ *             --shm. It prints one line per frame with the balls, and can be used as an example for
+ *             the overlay renderer and the statistics service.
+ */
+
+#include "../include/header.h"
+#include "../include/BallStateRing.h"
+#include <chrono>
+#include <thread>
+
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " < Shared memory name > [--latest]" << std::endl;
+        return -1;
+    }
+    bool only_latest = argc > 2 && std::string(argv[2]) == "--latest";
+
+    // Wait for the producer to create the ring
+    BallStateReader reader;
+    if (!reader.open(argv[1])) {
+        SVA_INFO("Waiting for the producer of %s", argv[1]);
+        while (!reader.open(argv[1])) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+
+    BallFrameState balls;
+    uint64_t lost = 0;
+    while (true) {
+        bool read = only_latest ? reader.latest(balls) : reader.next(balls);
+        if (!read) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        if (reader.lost() != lost) {
+            std::cout << "lost " << reader.lost() - lost << std::endl;
+            lost = reader.lost();
+        }
+        // frame N followed by: track label x y radius map_x map_y
+        std::cout << "frame " << balls.frame << " " << balls.size();
+        for (int i = 0; i < balls.size(); i++) {
+            std::cout << " " << balls.track_id[i] << " " << balls.label[i] << " " << balls.x[i] << " " << balls.y[i]
+                      << " " << balls.radius[i] << " " << balls.map_x[i] << " " << balls.map_y[i];
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
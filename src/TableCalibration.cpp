@@ -0,0 +1,93 @@
+/*
+ * File:    TableCalibration.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the TableCalibration structure which stores
+ *             the table corners, the perspective transformation to the minimap, the table polygon and
+ *             the cloth colour model of a fixed camera. The calibration is keyed by the resolution and
+ *             by a fingerprint of the first frame, so that later runs on the same camera can skip the
+ *             table detection.
+ */
+
+#include "../include/TableCalibration.h"
+
+// Version of the calibration files: 2 since the cloth colour model is learned on the table pixels only
+static const int kTableCalibrationVersion = 2;
+
+// Maximum mean absolute difference between two fingerprints of the same camera
+static const double kFingerprintThreshold = 12.0;
+
+// Function to compute a small blurred grayscale thumbnail of a frame
+cv::Mat TableCalibration::computeFingerprint(const cv::Mat& frame) {
+    cv::Mat gray, small;
+    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    cv::resize(gray, small, cv::Size(64, 36), 0, 0, cv::INTER_AREA);
+    cv::GaussianBlur(small, small, cv::Size(3, 3), 0);
+    return small;
+}
+
+// Function to check if the calibration belongs to the camera of a frame
+bool TableCalibration::matches(const cv::Mat& firstFrame) const {
+    if (firstFrame.size() != frame_size || fingerprint.empty()) return false;
+    cv::Mat current = computeFingerprint(firstFrame);
+    if (current.size() != fingerprint.size() || current.type() != fingerprint.type()) return false;
+    double diff = cv::norm(current, fingerprint, cv::NORM_L1) / static_cast<double>(current.total());
+    return diff < kFingerprintThreshold;
+}
+
+// Function to check if the calibration was saved in the current format
+bool TableCalibration::isCurrent() const {
+    return version == kTableCalibrationVersion;
+}
+
+void TableCalibration::read(const cv::FileStorage& fs) {
+    fs["version"] >> version;
+    int width = 0, height = 0;
+    fs["width"] >> width;
+    fs["height"] >> height;
+    frame_size = cv::Size(width, height);
+    fs["fingerprint"] >> fingerprint;
+    fs["corners"] >> corners;
+    fs["sorted_corners"] >> sorted_corners;
+    fs["homography"] >> homography;
+    fs["cloth_centers"] >> cloth_centers;
+}
+
+void TableCalibration::write(cv::FileStorage& fs) const {
+    fs << "version" << kTableCalibrationVersion;
+    fs << "width" << frame_size.width;
+    fs << "height" << frame_size.height;
+    fs << "fingerprint" << fingerprint;
+    fs << "corners" << corners;
+    fs << "sorted_corners" << sorted_corners;
+    fs << "homography" << homography;
+    fs << "cloth_centers" << cloth_centers;
+}
+
+bool TableCalibration::load(const std::string& filename) {
+    cv::FileStorage fs(filename, cv::FileStorage::READ);
+    if (!fs.isOpened()) return false;
+    read(fs);
+    fs.release();
+
+    if (!isCurrent()) {
+        SVA_WARN("The calibration %s has version %d instead of %d, the table is detected again",
+                 filename.c_str(), version, kTableCalibrationVersion);
+        return false;
+    }
+    if (corners.size() != 4 || sorted_corners.size() != 4) {
+        SVA_ERROR("Invalid calibration file %s", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TableCalibration::save(const std::string& filename) const {
+    cv::FileStorage fs(filename, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        SVA_ERROR("Failed to save the calibration %s", filename.c_str());
+        return false;
+    }
+    write(fs);
+    fs.release();
+    return true;
+}
@@ -223,41 +223,61 @@ cv::Point2f TableDetection::computeIntersection(cv::Vec2f line1, cv::Vec2f line2
     return cv::Point2f(x, y);
 }
 
-cv::Mat TableDetection::KMeans(const cv::Mat src) {
-    cv::Mat blurred;
-    cv::blur(src, blurred, cv::Size(7, 7));
-    // Convert the image to the XYZ color space
-    cv::cvtColor(src, blurred, cv::COLOR_BGR2XYZ);
-    cv::Mat reshaped = blurred.reshape(1, blurred.rows * blurred.cols);
+// Function to segment the balls from the cloth, clustering the colors of the table pixels only
+cv::Mat TableDetection::KMeans(FrameContext& context) {
+    const TableSpans& spans = context.spans();
+    if (spans.empty()) return cv::Mat::zeros(spans.roi.size(), CV_8UC1);
+
+    // Colors of the table pixels in the XYZ color space, one sample per row
+    const cv::Mat& xyz = context.xyz();
+    cv::Mat reshaped = xyz.reshape(1, static_cast<int>(xyz.total()));
     reshaped.convertTo(reshaped, CV_32F);
     // Apply KMeans clustering to create a mask for the ball
     int k = 2;
     cv::Mat labels, centers;
-    cv::kmeans(reshaped, k, labels, cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 10, 1.0), 3, cv::KMEANS_PP_CENTERS, centers);
-
-    labels = labels.reshape(0, blurred.rows);
-    cv::Mat mask(blurred.size(), CV_8UC1);
-    int ballCluster = 0; // Assuming cluster 0 is the ball, you may need to adjust this
-    for (int i = 0; i < blurred.rows; i++) {
-        for (int j = 0; j < blurred.cols; j++) {
-            mask.at<uchar>(i, j) = (labels.at<int>(i, j) == ballCluster) ? 255 : 0;
-        }
+    cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 10, 1.0);
+    cv::Mat& model = ballDetection_->cloth_centers_;
+    if (ballDetection_->warm_start_ && model.rows == k && model.cols == reshaped.cols && model.type() == CV_32F) {
+        // Start from the cloth colour model of the calibration, which is kept for every frame
+        labels.create(reshaped.rows, 1, CV_32S);
+        cv::parallel_for_(cv::Range(0, reshaped.rows), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                const float* p = reshaped.ptr<float>(i);
+                float best = FLT_MAX;
+                int label = 0;
+                for (int c = 0; c < k; c++) {
+                    const float* m = model.ptr<float>(c);
+                    float d = (p[0] - m[0]) * (p[0] - m[0]) + (p[1] - m[1]) * (p[1] - m[1]) + (p[2] - m[2]) * (p[2] - m[2]);
+                    if (d < best) {
+                        best = d;
+                        label = c;
+                    }
+                }
+                labels.at<int>(i) = label;
+            }
+        });
+        cv::kmeans(reshaped, k, labels, criteria, 1, cv::KMEANS_USE_INITIAL_LABELS, centers);
+    } else {
+        cv::kmeans(reshaped, k, labels, criteria, 3, cv::KMEANS_PP_CENTERS, centers);
+        // Cloth colour model saved in the calibration
+        model = centers.clone();
     }
 
-    cv::Mat result;
-    cv::bitwise_and(src, src, result, mask);
+    // The balls and the other objects cover less of the table than the cloth, so the ball
+    // cluster is the one with the fewest pixels
+    int ones = cv::countNonZero(labels);
+    int ballCluster = ones * 2 < labels.rows ? 1 : 0;
+    cv::Mat mask = labels == ballCluster;
 
-
-    cv::cvtColor(result, result, cv::COLOR_BGR2GRAY);
+    // The grayscale of the masked image is the masked grayscale
+    cv::Mat result = cv::Mat::zeros(mask.size(), CV_8UC1);
+    context.packedGray().copyTo(result, mask);
     cv::threshold(result, result, 1, 255, cv::THRESH_BINARY);
 
-    // calculate the mean color of the ball
-    cv::Scalar meanColor = cv::mean(src, mask);
-    double norm = cv::norm(meanColor);
-
-    if (norm > 200) cv::threshold(result, result, 1, 255, cv::THRESH_BINARY_INV);
-
-    return result;
+    // Back to the table rectangle, the pixels outside the table are not part of the mask
+    cv::Mat table_result;
+    spans.unpack(result, table_result, cv::Scalar(0));
+    return table_result;
 
 }
 
@@ -0,0 +1,63 @@
+/*
+ * File:    TableSpans.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the TableSpans structure, the table region
+ *             stored as one run of pixels per row. It is built once from the table polygon and used
+ *             to mask the frame, to gather the table pixels for the KMeans clustering and to filter
+ *             the blobs of the ball mask, without visiting the pixels outside the table.
+ */
+
+#include "../include/TableSpans.h"
+#include <cstring>
+
+void TableSpans::build(const cv::Mat& table_mask, const cv::Rect& rect) {
+    roi = rect & cv::Rect(0, 0, table_mask.cols, table_mask.rows);
+    spans.assign(roi.height, cv::Vec2i(0, 0));
+    area = 0;
+    for (int y = 0; y < roi.height; y++) {
+        const uchar* row = table_mask.ptr<uchar>(roi.y + y) + roi.x;
+        int begin = 0;
+        while (begin < roi.width && row[begin] == 0) begin++;
+        int end = roi.width;
+        while (end > begin && row[end - 1] == 0) end--;
+        spans[y] = cv::Vec2i(begin, end);
+        area += end - begin;
+    }
+}
+
+void TableSpans::copy(const cv::Mat& src, cv::Mat& dst) const {
+    dst.create(roi.size(), src.type());
+    size_t pixel = src.elemSize();
+    for (int y = 0; y < roi.height; y++) {
+        const uchar* in = src.ptr<uchar>(roi.y + y) + roi.x * pixel;
+        uchar* out = dst.ptr<uchar>(y);
+        int begin = spans[y][0], end = spans[y][1];
+        std::memset(out, 0, begin * pixel);
+        std::memcpy(out + begin * pixel, in + begin * pixel, (end - begin) * pixel);
+        std::memset(out + end * pixel, 0, (roi.width - end) * pixel);
+    }
+}
+
+void TableSpans::pack(const cv::Mat& src, cv::Mat& packed) const {
+    packed.create(area, 1, src.type());
+    size_t pixel = src.elemSize();
+    uchar* out = packed.data;
+    for (int y = 0; y < roi.height; y++) {
+        size_t bytes = (spans[y][1] - spans[y][0]) * pixel;
+        std::memcpy(out, src.ptr<uchar>(roi.y + y) + (roi.x + spans[y][0]) * pixel, bytes);
+        out += bytes;
+    }
+}
+
+void TableSpans::unpack(const cv::Mat& packed, cv::Mat& dst, const cv::Scalar& fill) const {
+    CV_Assert(packed.isContinuous() && static_cast<int>(packed.total()) == area);
+    dst.create(roi.size(), packed.type());
+    dst.setTo(fill);
+    size_t pixel = packed.elemSize();
+    const uchar* in = packed.data;
+    for (int y = 0; y < roi.height; y++) {
+        size_t bytes = (spans[y][1] - spans[y][0]) * pixel;
+        std::memcpy(dst.ptr<uchar>(y) + spans[y][0] * pixel, in, bytes);
+        in += bytes;
+    }
+}
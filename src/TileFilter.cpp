@@ -0,0 +1,36 @@
+/*
+ * File:    TileFilter.cpp
+ * Date:    October 19, 2026
+ * Description: This file contains the implementation of the tiled filters used by the ball detection.
+ *             A chain of filters is run on tiles small enough to stay in the cache, instead of one
+ *             full pass over the image per filter, and the tiles are distributed over the threads of
+ *             the OpenCV thread pool.
+ */
+
+#include "../include/TileFilter.h"
+
+// Size of the tiles, small enough for the chain of a tile to stay in the L2 cache
+static const size_t kTileBytes = 64 * 1024;
+
+void parallelTileFilter(const cv::Mat& src, cv::Mat& dst, int halo, const TileFunction& filter) {
+    CV_Assert(src.data != dst.data || src.empty());
+    dst.create(src.size(), src.type());
+    if (src.empty()) return;
+
+    size_t row_bytes = src.cols * src.elemSize();
+    int tile_rows = std::max(2 * halo, static_cast<int>(kTileBytes / std::max<size_t>(row_bytes, 1)));
+    int tiles = (src.rows + tile_rows - 1) / tile_rows;
+
+    cv::parallel_for_(cv::Range(0, tiles), [&](const cv::Range& range) {
+        cv::Mat out;
+        for (int t = range.start; t < range.end; t++) {
+            int y0 = t * tile_rows;
+            int y1 = std::min(src.rows, y0 + tile_rows);
+            // Rows of the tile with its halo
+            int a0 = std::max(0, y0 - halo);
+            int a1 = std::min(src.rows, y1 + halo);
+            filter(src.rowRange(a0, a1), out);
+            out.rowRange(y0 - a0, y1 - a0).copyTo(dst.rowRange(y0, y1));
+        }
+    });
+}
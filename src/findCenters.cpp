@@ -12,14 +12,20 @@
 
 findCenters::findCenters(BallDetection *ballDetection1) : ballDetection_(ballDetection1) {}
 std::vector<cv::Point2f> findCenters::findCenter(cv::Mat img) {
-    // Convert the image to grayscale
+    // Convert the image to grayscale, unless it is already
     cv::Mat gray;
-    cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+    if (img.channels() == 1) {
+        gray = img;
+    } else {
+        cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+    }
     // Apply Median Blur to reduce noise
     cv::medianBlur(gray, gray, 1);
     // Apply Hough Circle Transform
     std::vector<cv::Vec3f> circles;
-    cv::HoughCircles(gray, circles, cv::HOUGH_GRADIENT, 1, gray.rows / 16, 107, 10, 5, 12);
+    const DetectorConfig& config = ballDetection_->config_;
+    cv::HoughCircles(gray, circles, cv::HOUGH_GRADIENT, 1, gray.rows / config.min_dist_divisor, config.candidate_canny,
+                     config.candidate_votes, config.candidate_min_radius, config.candidate_max_radius);
 
     std::vector<cv::Point2f> centers;
 
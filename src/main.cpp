@@ -1,25 +1,136 @@
 #include "../include/header.h"
 #include "../include/BallDetection.h"
+#include "../include/ArgParse.h"
 
 
+// Function to print the usage of the program
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " < Input video path > " << " < Output video path > "
+              << " [--start < frame >] [--end < frame >] [--stride < K >] [--analysis-only]"
+              << " [--sink video|images|raw|y4m|null] [--codec < fourcc | png | jpg >] [--compression < level >] [--no-preview] [--calibration < file >]"
+              << " [--checkpoint < frames >] [--resume] [--shm < name >] [--verbose]"
+              << " [--save-analysis < file >] [--render-from < file >] [--minimap-size < W >x< H >] [--ball-radius < px >] [--no-trail]"
+              << " [--overlay top-left|top-right|bottom-left|bottom-right] [--verify-mask]"
+              << " [--background] [--verify-background] [--ball-cache] [--config < file >]"
+              << std::endl;
+}
 
 
 int main(int argc, char** argv ) {
 
 
     if (argc < 3) {
-        std::cout << "Usage: " << argv[0] << " < Input video path > " << " < Output video path > " << std::endl;
+        printUsage(argv[0]);
         return -1;
 
     }
 
+    // Parse the optional arguments
+    ProcessOptions options;
+    DetectorConfig config;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--analysis-only") {
+            options.analysis_only = true;
+            continue;
+        }
+        if (arg == "--no-preview") {
+            options.preview = false;
+            continue;
+        }
+        if (arg == "--resume") {
+            options.resume = true;
+            continue;
+        }
+        if (arg == "--ball-cache") {
+            options.ball_cache = true;
+            continue;
+        }
+        if (arg == "--background") {
+            options.background = true;
+            continue;
+        }
+        if (arg == "--verify-background") {
+            options.verify_background = true;
+            continue;
+        }
+        if (arg == "--verify-mask") {
+            options.verify_mask = true;
+            continue;
+        }
+        if (arg == "--no-trail") {
+            options.trail = false;
+            continue;
+        }
+        if (arg == "--verbose") {
+            Logger::instance().setLevel(LOG_LEVEL_DEBUG);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return -1;
+        }
+        bool valid = true;
+        if (arg == "--start") {
+            valid = parseInt(argv[++i], 0, options.start);
+        } else if (arg == "--end") {
+            valid = parseInt(argv[++i], -1, options.end);
+        } else if (arg == "--stride") {
+            valid = parseInt(argv[++i], 1, options.stride);
+        } else if (arg == "--sink") {
+            options.sink = argv[++i];
+        } else if (arg == "--codec") {
+            options.codec = argv[++i];
+        } else if (arg == "--compression") {
+            valid = parseInt(argv[++i], 0, options.compression);
+        } else if (arg == "--calibration") {
+            options.calibration = argv[++i];
+        } else if (arg == "--config") {
+            if (!config.load(argv[++i])) return -1;
+        } else if (arg == "--checkpoint") {
+            valid = parseInt(argv[++i], 0, options.checkpoint);
+        } else if (arg == "--shm") {
+            options.shm = argv[++i];
+        } else if (arg == "--save-analysis") {
+            options.save_analysis = argv[++i];
+        } else if (arg == "--render-from") {
+            options.render_from = argv[++i];
+        } else if (arg == "--minimap-size") {
+            int w = 0, h = 0;
+            char extra;
+            if (std::sscanf(argv[++i], "%dx%d%c", &w, &h, &extra) != 2 || w <= 0 || h <= 0) {
+                printUsage(argv[0]);
+                return -1;
+            }
+            options.map_size = cv::Size(w, h);
+        } else if (arg == "--ball-radius") {
+            valid = parseInt(argv[++i], 1, options.ball_radius);
+        } else if (arg == "--overlay") {
+            options.overlay = argv[++i];
+            if (options.overlay != "top-left" && options.overlay != "top-right" &&
+                options.overlay != "bottom-left" && options.overlay != "bottom-right") {
+                printUsage(argv[0]);
+                return -1;
+            }
+        } else {
+            printUsage(argv[0]);
+            return -1;
+        }
+        if (!valid) {
+            SVA_ERROR("Invalid value %s for %s", argv[i], arg.c_str());
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+
     BallDetection bd;
+    bd.setConfig(config);
 
-    if (!bd.process_video(argv[1], argv[2])) {
-        std::cerr << "Error: Could not process video" << std::endl;
+    if (!bd.process_video(argv[1], argv[2], options)) {
+        SVA_ERROR("Could not process video");
         return -1;
     }
 
 
     return 0;
-}
\ No newline at end of file
+}
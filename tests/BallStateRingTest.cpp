@@ -0,0 +1,187 @@
+/*
+ * File:    BallStateRingTest.cpp
+ * Date:    October 19, 2026
+ * Description: Test of the shared-memory ring with a consumer in another process. The parent publishes
+ *             the states, a forked child reads them with BallStateReader and checks the order and the
+ *             content of the states, the states skipped when the reader is too slow, latest(), and the
+ *             switch to the ring of a new producer. The two processes take turns through pipes.
+ */
+
+#include "../include/BallStateRing.h"
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const char* kRingName = "/sva_ring_test";
+static const uint32_t kSlots = 8;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return 1; \
+        } \
+    } while (0)
+
+// Function to build the state of a frame, with values derived from the frame index
+static BallFrameState makeState(int frame) {
+    BallFrameState balls;
+    balls.frame = frame;
+    balls.clear();
+    for (int i = 0; i < 3; i++) {
+        int b = balls.push(frame * 10.0f + i, frame * 20.0f + i, 10.0f + i, 1.0f);
+        balls.label[b] = (frame + i) % 5;
+        balls.track_id[b] = frame + i;
+        balls.map_x[b] = frame + 0.5f;
+        balls.map_y[b] = frame + 0.25f;
+    }
+    return balls;
+}
+
+// Function to check that a state read from the ring is the one published for the frame
+static bool sameState(const BallFrameState& balls, int frame) {
+    BallFrameState expected = makeState(frame);
+    if (balls.frame != frame || balls.size() != expected.size()) return false;
+    for (int i = 0; i < balls.size(); i++) {
+        if (balls.x[i] != expected.x[i] || balls.y[i] != expected.y[i] || balls.radius[i] != expected.radius[i] ||
+            balls.label[i] != expected.label[i] || balls.track_id[i] != expected.track_id[i] ||
+            balls.map_x[i] != expected.map_x[i] || balls.map_y[i] != expected.map_y[i]) return false;
+    }
+    return true;
+}
+
+static void notify(int fd) {
+    char c = 1;
+    if (write(fd, &c, 1) != 1) std::_Exit(2);
+}
+
+// Function to wait for the other process, which exits with 2 when that process ended first
+static void waitFor(int fd) {
+    char c;
+    if (read(fd, &c, 1) != 1) {
+        std::fprintf(stderr, "The other process ended before signalling\n");
+        std::_Exit(2);
+    }
+}
+
+// Function to wait for the next state, the reader attaches to a new ring at most every 100 ms
+static bool nextWithin(BallStateReader& reader, BallFrameState& balls, int ms) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end) {
+        if (reader.next(balls)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+static int consumer(int from_parent, int to_parent) {
+    BallStateReader reader;
+    CHECK(reader.open(kRingName));
+    CHECK(reader.mapWidth() == 400 && reader.mapHeight() == 800);
+    notify(to_parent);
+
+    // States that fit in the ring are all read, in order and intact
+    BallFrameState balls;
+    waitFor(from_parent);
+    for (int frame = 0; frame < static_cast<int>(kSlots); frame++) {
+        CHECK(reader.next(balls));
+        CHECK(sameState(balls, frame));
+    }
+    CHECK(!reader.next(balls));
+    CHECK(reader.lost() == 0);
+    notify(to_parent);
+
+    // 20 states published while the reader waits: the 12 overwritten ones are skipped
+    waitFor(from_parent);
+    for (int frame = 20; frame < 28; frame++) {
+        CHECK(reader.next(balls));
+        CHECK(sameState(balls, frame));
+    }
+    CHECK(!reader.next(balls));
+    CHECK(reader.lost() == 12);
+    notify(to_parent);
+
+    // latest() skips to the most recent state
+    waitFor(from_parent);
+    CHECK(reader.latest(balls));
+    CHECK(sameState(balls, 30));
+    CHECK(reader.lost() == 14);
+    CHECK(!reader.latest(balls));
+    notify(to_parent);
+
+    // A new producer replaces the ring: the reader attaches to it and reads its first state
+    waitFor(from_parent);
+    CHECK(nextWithin(reader, balls, 2000));
+    CHECK(sameState(balls, 100));
+    notify(to_parent);
+
+    // The producer closes its ring and a new one is opened later
+    waitFor(from_parent);
+    CHECK(nextWithin(reader, balls, 2000));
+    CHECK(sameState(balls, 200));
+    CHECK(!reader.next(balls));
+    return 0;
+}
+
+int main() {
+    int down[2], up[2];
+    if (pipe(down) != 0 || pipe(up) != 0) return 1;
+    // A write to a process that ended fails instead of killing the writer
+    std::signal(SIGPIPE, SIG_IGN);
+
+    BallStatePublisher publisher;
+    CHECK(publisher.open(kRingName, 400, 800, kSlots));
+
+    // Each side closes the ends it does not use, so that the exit of the other side is seen
+    // as the end of the pipe instead of blocking
+    pid_t pid = fork();
+    if (pid < 0) return 1;
+    if (pid == 0) {
+        close(up[0]);
+        close(down[1]);
+        int result = consumer(down[0], up[1]);
+        std::fflush(stderr);
+        std::_Exit(result);
+    }
+    close(up[1]);
+    close(down[0]);
+
+    waitFor(up[0]);
+    for (int frame = 0; frame < static_cast<int>(kSlots); frame++) publisher.publish(makeState(frame));
+    notify(down[1]);
+    waitFor(up[0]);
+
+    for (int frame = 8; frame < 28; frame++) publisher.publish(makeState(frame));
+    notify(down[1]);
+    waitFor(up[0]);
+
+    for (int frame = 28; frame < 31; frame++) publisher.publish(makeState(frame));
+    notify(down[1]);
+    waitFor(up[0]);
+
+    // A second producer takes the name while the first one is still open
+    BallStatePublisher replacement;
+    CHECK(replacement.open(kRingName, 400, 800, kSlots));
+    replacement.publish(makeState(100));
+    // Closing the first producer must not remove the ring of the second one
+    publisher.close();
+    BallStateReader check;
+    CHECK(check.open(kRingName));
+    check.close();
+    notify(down[1]);
+    waitFor(up[0]);
+
+    replacement.close();
+    CHECK(publisher.open(kRingName, 400, 800, kSlots));
+    publisher.publish(makeState(200));
+    notify(down[1]);
+
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    publisher.close();
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::printf("BallStateRingTest passed\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * File:    ContourMaskTest.cpp
+ * Date:    October 19, 2026
+ * Description: Test of the tiled contour mask. On every sample frame the mask computed tile by tile
+ *             must be identical, bit for bit, to the mask computed with one full pass per filter.
+ *             The frames are read from the video given as argument, or drawn when there is none.
+ *             The time of both masks is reported for several numbers of threads.
+ */
+
+#include "../include/BallDetection.h"
+#include "../include/FrameContext.h"
+#include <random>
+
+struct Sample {
+    cv::Mat frame;
+    TableSpans spans;
+};
+
+// Function to build the spans of the table polygon of a frame
+static void buildSpans(Sample& sample, const std::vector<cv::Point2f>& polygon) {
+    std::vector<cv::Point> corners;
+    for (const auto& pt : polygon) {
+        corners.emplace_back(pt);
+    }
+    cv::Mat table_mask = cv::Mat::zeros(sample.frame.size(), CV_8UC1);
+    cv::fillConvexPoly(table_mask, corners, cv::Scalar(5, 5, 5));
+    sample.spans.build(table_mask, cv::boundingRect(corners));
+}
+
+// Function to draw a table with balls and sensor noise, with the table polygon of the frame
+static Sample drawSample(const cv::Size& size, std::mt19937& rng) {
+    Sample sample;
+    sample.frame = cv::Mat(size, CV_8UC3, cv::Scalar(40, 40, 40));
+    float w = static_cast<float>(size.width), h = static_cast<float>(size.height);
+    std::vector<cv::Point2f> polygon = {{0.2f * w, 0.1f * h}, {0.8f * w, 0.1f * h}, {0.95f * w, 0.9f * h}, {0.05f * w, 0.9f * h}};
+    std::vector<cv::Point> corners(polygon.begin(), polygon.end());
+    cv::fillConvexPoly(sample.frame, corners, cv::Scalar(60, 140, 30));
+
+    std::uniform_real_distribution<float> x(0.25f * w, 0.75f * w), y(0.15f * h, 0.85f * h);
+    std::uniform_int_distribution<int> channel(0, 255);
+    int radius = std::max(4, size.height / 60);
+    for (int i = 0; i < 16; i++) {
+        cv::Point center(static_cast<int>(x(rng)), static_cast<int>(y(rng)));
+        cv::circle(sample.frame, center, radius, cv::Scalar(channel(rng), channel(rng), channel(rng)), -1, cv::LINE_AA);
+        cv::circle(sample.frame, center - cv::Point(radius / 3, radius / 3), radius / 4, cv::Scalar(255, 255, 255), -1);
+    }
+    cv::Mat noise(size, CV_16SC3);
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(6));
+    cv::add(sample.frame, noise, sample.frame, cv::noArray(), CV_8UC3);
+    buildSpans(sample, polygon);
+    return sample;
+}
+
+// Function to read frames spread over a video and to detect the table on the first one
+static bool readSamples(const std::string& path, BallDetection& bd, std::vector<Sample>& samples) {
+    cv::VideoCapture capture(path);
+    if (!capture.isOpened()) {
+        SVA_ERROR("Could not open the video %s", path.c_str());
+        return false;
+    }
+    int total = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_COUNT));
+    int step = std::max(1, total / 8);
+    std::vector<cv::Point2f> polygon;
+    for (int pos = 0; samples.size() < 8; pos += step) {
+        capture.set(cv::CAP_PROP_POS_FRAMES, pos);
+        Sample sample;
+        if (!capture.read(sample.frame)) break;
+        if (polygon.empty()) {
+            TableDetection vp(&bd);
+            if (!vp.detectTableCorners(sample.frame)) {
+                SVA_ERROR("Could not detect table corners");
+                return false;
+            }
+            polygon = sortCorners(vp.tableCorners_);
+        }
+        buildSpans(sample, polygon);
+        samples.push_back(sample);
+    }
+    return !samples.empty();
+}
+
+// Function to compute the mask of every sample, in ms per frame. The context is reset for every
+// frame so that the blur and the edges are computed again, as in the analysis
+static double timeMasks(BallDetection& bd, std::vector<Sample>& samples, bool reference, int rounds) {
+    FrameContext context;
+    double ticks = 0;
+    for (int round = 0; round < rounds; round++) {
+        for (Sample& sample : samples) {
+            context.reset(sample.frame, sample.spans, bd.config());
+            double t = static_cast<double>(cv::getTickCount());
+            cv::Mat mask = reference ? bd.referenceContourMask(context.tableGray()) : bd.contourMask(context);
+            ticks += static_cast<double>(cv::getTickCount()) - t;
+        }
+    }
+    return ticks / cv::getTickFrequency() * 1000.0 / (rounds * samples.size());
+}
+
+int main(int argc, char** argv) {
+    BallDetection bd;
+    std::vector<Sample> samples;
+    if (argc > 1) {
+        if (!readSamples(argv[1], bd, samples)) return 1;
+    } else {
+        // Odd sizes give a last tile shorter than the halo
+        std::mt19937 rng(7);
+        for (const cv::Size& size : {cv::Size(1920, 1080), cv::Size(1280, 720), cv::Size(641, 479), cv::Size(320, 37)}) {
+            samples.push_back(drawSample(size, rng));
+            samples.push_back(drawSample(size, rng));
+        }
+    }
+
+    // Same mask with every number of threads
+    std::vector<int> threads = {1, 2, 4, cv::getNumberOfCPUs()};
+    int failed = 0;
+    for (int n : threads) {
+        cv::setNumThreads(n);
+        FrameContext context;
+        for (size_t i = 0; i < samples.size(); i++) {
+            context.reset(samples[i].frame, samples[i].spans, bd.config());
+            cv::Mat mask = bd.contourMask(context);
+            cv::Mat reference = bd.referenceContourMask(context.tableGray());
+            int diff = cv::countNonZero(mask != reference);
+            if (mask.size() != reference.size() || diff > 0) {
+                SVA_ERROR("Sample %d with %d threads: the tiled mask differs in %d pixels", static_cast<int>(i), n, diff);
+                failed++;
+            }
+        }
+    }
+
+    // Time of both masks, the speedup is relative to the full passes with the same threads
+    for (int n : threads) {
+        cv::setNumThreads(n);
+        double tiled_ms = timeMasks(bd, samples, false, 5);
+        double reference_ms = timeMasks(bd, samples, true, 5);
+        SVA_INFO("%d threads: tiled %.2f ms, reference %.2f ms per frame, speedup %.2f", n, tiled_ms, reference_ms,
+                 reference_ms / std::max(tiled_ms, 1e-6));
+    }
+
+    if (failed > 0) return 1;
+    SVA_INFO("ContourMaskTest passed on %d frames", static_cast<int>(samples.size()));
+    return 0;
+}